@@ -2,14 +2,126 @@
 #include "oscode2.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
+#include <strings.h>
 #include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <dirent.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <errno.h>
 
 // Game system constants
 #define MAX_GAMES 256
 #define MAX_GAME_NAME 64
+#define MAX_GAME_AUTHOR 32
 #define MAX_SAVE_SLOTS 10
+
+// The registry grows in powers of two from this many rows
+#define GAME_REGISTRY_MIN_CAPACITY 64
+
+// Arena bytes per registry row for the interned names, authors and paths
+#define GAME_REGISTRY_STRING_BYTES 64
+
+// Registry catalog file. The column block starts on a page boundary.
+#define GAME_CATALOG_PATH "/games/registry.catalog"
+#define GAME_CATALOG_VERSION 5
+#define GAME_CATALOG_DATA_OFFSET 4096
+
+// Directory scans follow subdirectories at most this deep
+#define GAME_SCAN_MAX_DEPTH 8
+
+// The watcher applies a burst of changes once no event arrived for the
+// settle time, or at the latest after the maximum delay
+#define GAME_WATCH_SETTLE_MS 100
+#define GAME_WATCH_MAX_DELAY_MS 1000
+
+// Installs copy packages into a staging directory and record what they
+// are about to change in a journal before changing /games
+#define GAME_STAGING_DIR "/games/.staging"
+#define GAME_JOURNAL_PATH GAME_STAGING_DIR "/install.journal"
+#define GAME_INSTALL_COPY_CHUNK (1024 * 1024)
+
 #define GAME_SIGNATURE 0x47414D45  // "GAME" in hex
 #define SAVE_SIGNATURE 0x53415645  // "SAVE" in hex
+#define SAVE_DELTA_SIGNATURE 0x53444C54  // "SDLT" in hex
+#define SNAPSHOT_SIGNATURE 0x534E4150  // "SNAP" in hex
+#define PREFETCH_SIGNATURE 0x50524546  // "PREF" in hex
+#define JOURNAL_SIGNATURE 0x4A524E4C  // "JRNL" in hex
+#define CATALOG_SIGNATURE 0x4341544C  // "CATL" in hex
+
+// Package format versions
+#define GAME_VERSION_BASIC 1     // Header followed by raw code and data
+#define GAME_VERSION_EXTENDED 2  // Header extension follows the header
+#define GAME_VERSION_SECTIONS 3  // Section directory follows the extension
+
+// Section directory limits
+#define MAX_GAME_SECTIONS 256
+#define GAME_SECTION_NAME 32
+
+// Native module limits
+#define GAME_SYMBOL_NAME 32
+#define GAME_MODULE_CACHE_SLOTS 8
+
+// Section compression
+#define GAME_COMPRESSION_NONE 0
+#define GAME_COMPRESSION_LZ 1
+
+// Built-in LZ codec parameters
+#define GAME_LZ_MIN_MATCH 4
+#define GAME_LZ_HASH_BITS 12
+
+// Image checksums. Chunked checksums hash fixed-size chunks independently
+// so they can be verified in parallel while a package is still loading.
+#define GAME_CHECKSUM_NONE 0
+#define GAME_CHECKSUM_CHUNKED 1
+#define GAME_CHECKSUM_CHUNK_SIZE (64 * 1024)
+
+// Header probes are read in batches of this many packages per pool task
+#define GAME_PROBE_BATCH 16
+
+// Worker pool limits
+#define GAME_POOL_MAX_THREADS 8
+#define GAME_POOL_QUEUE_SIZE 1024
+
+// Image cache limits
+#define GAME_IMAGE_CACHE_SLOTS 16
+#define GAME_IMAGE_CACHE_BUDGET (32 * 1024 * 1024)
+
+// Post-init snapshots keep the data image page aligned so it can be mapped
+#define GAME_SNAPSHOT_VERSION 1
+#define GAME_SNAPSHOT_DATA_OFFSET 4096
+
+// Saves track the save region in blocks and append the blocks that changed
+// to the slot file. The slot is rewritten in full once it holds this many
+// delta records, or more delta bytes than a full save takes.
+#define GAME_SAVE_VERSION 3
+#define GAME_SAVE_BLOCK_SIZE 64
+#define GAME_SAVE_MAX_DELTAS 64
+
+// The saver makes at most this many saves durable with one shared flush
+#define GAME_SAVE_GROUP_MAX 32
+
+// Compressed saves, and legacy save records whole, are read back through
+// a staging buffer of this size
+#define GAME_SAVE_STAGING_SIZE (16 * 1024)
+
+// Game load flags
+#define GAME_LOAD_MAPPED 0x01  // Map code/data straight from the package image
+#define GAME_LOAD_RECORD_PREFETCH 0x02  // Record reads into a prefetch manifest
+
+// Prefetch manifests list at most this many ranges
+#define GAME_PREFETCH_MAX_RANGES 1024
+
+// Sections are read in chunks of this size so loads can report progress
+// and be cancelled part way through
+#define GAME_LOAD_CHUNK_SIZE (256 * 1024)
 
 // Game states
 typedef enum {
@@ -36,7 +148,7 @@ typedef struct {
     uint32_t signature;
     uint32_t version;
     char name[MAX_GAME_NAME];
-    char author[32];
+    char author[MAX_GAME_AUTHOR];
     game_type_t type;
     uint32_t code_size;
     uint32_t data_size;
@@ -46,21 +158,198 @@ typedef struct {
     uint32_t checksum;
 } game_header_t;
 
-// Save game structure
+// Header extension, present from GAME_VERSION_EXTENDED. ext_size records
+// how many bytes were written so older and newer layouts can be read.
+typedef struct {
+    uint32_t ext_size;
+    uint32_t code_compression;
+    uint32_t code_stored_size;
+    uint32_t data_compression;
+    uint32_t data_stored_size;
+    uint32_t section_count;
+    uint32_t checksum_type;
+} game_header_ext_t;
+
+#define GAME_HEADER_EXT_MIN_SIZE 20
+
+// Section kinds
+typedef enum {
+    GAME_SECTION_CODE = 0,
+    GAME_SECTION_DATA = 1,
+    GAME_SECTION_ASSET = 2,
+    GAME_SECTION_RELOCS = 3,    // game_reloc_t entries applied to the code
+    GAME_SECTION_IMPORTS = 4,   // game_import_t entries resolved at load
+    GAME_SECTION_PREFETCH = 5   // game_prefetch_range_t entries in access order
+} game_section_kind_t;
+
+// Section directory entry. The directory lists the code and static data
+// sections plus any named asset chunks, which are only read on first use.
+typedef struct {
+    char name[GAME_SECTION_NAME];
+    uint32_t kind;
+    uint32_t compression;
+    uint32_t offset;        // From the start of the package
+    uint32_t size;
+    uint32_t stored_size;
+    uint32_t checksum;      // Chunked checksum of an asset's contents
+} game_section_t;
+
+// Resident state of an asset section
+typedef struct {
+    void* memory;
+    uint32_t ref_count;
+    uint32_t last_used;
+} game_asset_t;
+
+// Extra section passed to the package writer
+typedef struct {
+    const char* name;
+    uint32_t kind;
+    const void* data;
+    uint32_t size;
+} game_package_section_t;
+
+// Relocation types. Both store a 64-bit address into the code section.
+typedef enum {
+    GAME_RELOC_CODE = 0,     // Code base + addend
+    GAME_RELOC_IMPORT = 1    // Address of import symbol + addend
+} game_reloc_type_t;
+
+typedef struct {
+    uint32_t offset;        // Within the code section
+    uint32_t type;
+    uint32_t symbol;        // Import index for GAME_RELOC_IMPORT
+    int32_t addend;
+} game_reloc_t;
+
+typedef struct {
+    char name[GAME_SYMBOL_NAME];
+} game_import_t;
+
+// Service exported to native game modules
+typedef struct {
+    const char* name;
+    void* address;
+} game_symbol_t;
+
+// Streaming decoder states
+enum {
+    GAME_LZ_STATE_TOKEN = 0,
+    GAME_LZ_STATE_LITERAL_LENGTH = 1,
+    GAME_LZ_STATE_LITERALS = 2,
+    GAME_LZ_STATE_OFFSET_LOW = 3,
+    GAME_LZ_STATE_OFFSET_HIGH = 4,
+    GAME_LZ_STATE_MATCH_LENGTH = 5
+};
+
+// Streaming LZ decoder writing straight into its destination buffer
+typedef struct {
+    uint8_t* out;
+    uint32_t out_size;
+    uint32_t out_pos;
+    uint32_t state;
+    uint32_t literal_length;
+    uint32_t match_length;
+    uint32_t offset;
+} game_lz_stream_t;
+
+// Snapshot of a game's state once its initialization has finished,
+// stored in /games/<name>.snap ahead of a copy of data_memory
+typedef struct {
+    uint32_t signature;
+    uint32_t version;
+    uint32_t game_checksum;
+    uint32_t data_size;
+    uint32_t data_checksum;
+    uint32_t resume_point;
+    uint32_t current_level;
+    uint32_t current_score;
+} game_snapshot_header_t;
+
+// Hot range of a section's stored bytes, listed in a prefetch manifest
+typedef struct {
+    uint32_t section;
+    uint32_t offset;
+    uint32_t size;
+} game_prefetch_range_t;
+
+// Recorded prefetch manifest, stored in /games/<name>.prefetch ahead of
+// its ranges. Packages can carry the same ranges as a prefetch section.
+typedef struct {
+    uint32_t signature;
+    uint32_t game_checksum;
+    uint32_t range_count;
+} game_prefetch_header_t;
+
+// Header of a save slot file, followed by stored_size bytes holding the
+// game's save region, compressed as compression says, and then any delta
+// records
 typedef struct {
     uint32_t signature;
+    uint32_t version;
     uint32_t game_checksum;
     uint32_t save_time;
     uint32_t play_time;
     uint32_t level;
     uint32_t score;
     uint32_t data_size;
-    uint8_t save_data[4096];  // Game-specific save data
+    uint32_t data_checksum; // Of the uncompressed data
+    uint32_t compression;
+    uint32_t stored_size;
+    uint32_t checksum;      // Of the fields above
 } save_game_t;
 
+// Slot header of GAME_SAVE_VERSION 2, whose data was never compressed
+typedef struct {
+    uint32_t signature;
+    uint32_t version;
+    uint32_t game_checksum;
+    uint32_t save_time;
+    uint32_t play_time;
+    uint32_t level;
+    uint32_t score;
+    uint32_t data_size;
+    uint32_t data_checksum;
+    uint32_t checksum;      // Of the fields above
+} save_game_v2_t;
+
+// Slot record from before save versions, holding the data inline. The
+// first saves end at save_data; later ones add a checksum of the fields
+// and data_size bytes of save_data. Delta records may follow either.
+typedef struct {
+    uint32_t signature;
+    uint32_t game_checksum;
+    uint32_t save_time;
+    uint32_t play_time;
+    uint32_t level;
+    uint32_t score;
+    uint32_t data_size;
+    uint8_t save_data[4096];
+    uint32_t checksum;
+} save_game_legacy_t;
+
+// Record appended to a slot file after its save data, followed by the
+// save blocks that changed since the record before it. Each block is its
+// uint32_t index and its bytes; only the last block of the region is
+// short. Loading replays records in order up to the first that doesn't
+// check out, so a torn append loses just that save.
+typedef struct {
+    uint32_t signature;
+    uint32_t sequence;      // 1 for the first record after the base
+    uint32_t save_time;
+    uint32_t play_time;
+    uint32_t level;
+    uint32_t score;
+    uint32_t block_count;
+    uint32_t payload_size;
+    uint32_t payload_checksum;
+    uint32_t checksum;      // Of the fields above
+} save_delta_header_t;
+
 // Game instance
 typedef struct {
     game_header_t header;
+    game_header_ext_t header_ext;
     uint32_t process_id;
     game_state_t state;
     void* code_memory;
@@ -72,26 +361,426 @@ typedef struct {
     uint32_t current_score;
     char save_path[MAX_PATH];
     bool has_save_data;
+    
+    // Direct mappings of the package image (GAME_LOAD_MAPPED)
+    uint32_t load_flags;
+    void* code_mapping;
+    size_t code_mapping_size;
+    void* data_mapping;
+    size_t data_mapping_size;
+    
+    // Section directory and lazily loaded assets. resident_memory counts
+    // code, data and resident assets against max_game_memory.
+    char package_path[MAX_PATH];
+    uint32_t code_offset;
+    uint32_t data_offset;
+    game_section_t* sections;
+    game_asset_t* assets;
+    uint32_t section_count;
+    uint32_t resident_memory;
+    uint32_t asset_clock;
+    
+    // Prelinked code image the code section runs from, if shared
+    void* module;
+    
+    // Code offset to enter instead of entry_point after a snapshot restore
+    uint32_t resume_point;
+    
+    // Package reads recorded under GAME_LOAD_RECORD_PREFETCH
+    game_prefetch_range_t* prefetch_log;
+    uint32_t prefetch_count;
+    
+    // Save blocks changed since the last save to or load from save_slot.
+    // save_shadow holds the save region as that slot has it, so games
+    // that don't mark their writes are compared against it.
+    uint8_t* save_dirty;
+    uint8_t* save_shadow;
+    uint32_t save_slot;     // Slot plus one, 0 while no slot is tracked
+    bool save_marked;
+    uint8_t save_compression[MAX_SAVE_SLOTS];
 } game_instance_t;
 
+// Asynchronous load status
+typedef enum {
+    GAME_LOAD_RUNNING = 0,
+    GAME_LOAD_DONE = 1,
+    GAME_LOAD_FAILED = 2,
+    GAME_LOAD_CANCELLED = 3
+} game_load_status_t;
+
+// Progress callback, invoked on the loader thread after every chunk
+typedef void (*game_load_progress_func)(uint32_t bytes_loaded, uint32_t bytes_total, void* user_data);
+
+// Background save status
+typedef enum {
+    GAME_SAVE_PENDING = 0,
+    GAME_SAVE_DONE = 1,
+    GAME_SAVE_FAILED = 2
+} game_save_status_t;
+
+// Completion callback, invoked on the saver thread once a save is written
+typedef void (*game_save_done_func)(int slot, game_save_status_t status, void* user_data);
+
+// Save captured on the game thread and written by the saver thread. data
+// is a copy of the save region taken when the save was requested; dirty
+// lists the blocks changed since the game's previous save to the same
+// slot, and is NULL when the slot must be written in full. Owned by the
+// caller until game_save_finish.
+typedef struct game_save_job {
+    struct game_save_job* next;
+    char path[MAX_PATH];
+    int slot;
+    uint32_t game_checksum;
+    uint32_t save_time;
+    uint32_t play_time;
+    uint32_t level;
+    uint32_t score;
+    uint32_t size;
+    uint32_t compression;   // Of the data in a full save; deltas stay raw
+    uint8_t* data;
+    uint8_t* dirty;
+    
+    uint32_t status;        // Accessed atomically
+    game_save_done_func done;
+    void* user_data;
+} game_save_job_t;
+
+// Saver thread and its queue. Jobs are written in the order they were
+// queued. The saver remembers the slot file it last wrote, so a delta is
+// only appended to a file known to hold the save before it.
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;    // Signalled when jobs are queued or finish
+    game_save_job_t* head;
+    game_save_job_t* tail;
+    uint32_t pending;       // Jobs queued or being written
+    bool running;
+    bool stopping;
+    
+    char last_path[MAX_PATH];
+    uint32_t deltas;
+    uint32_t delta_bytes;
+} game_saver_t;
+
+// Worker pool task
+typedef void (*game_task_func)(void* arg);
+
+typedef struct {
+    game_task_func func;
+    void* arg;
+} game_task_t;
+
+// Fixed set of worker threads shared by the game system
+typedef struct {
+    pthread_t threads[GAME_POOL_MAX_THREADS];
+    uint32_t thread_count;
+    game_task_t queue[GAME_POOL_QUEUE_SIZE];
+    uint32_t head;
+    uint32_t count;
+    bool stopping;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+} game_thread_pool_t;
+
+// Counts outstanding tasks so a submitter can wait for all of them
+typedef struct {
+    uint32_t pending;
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+} game_task_group_t;
+
 // Game registry entry
 typedef struct {
     char name[MAX_GAME_NAME];
+    char author[MAX_GAME_AUTHOR];
     char path[MAX_PATH];
     game_type_t type;
     uint32_t size;
     uint32_t last_played;
+    uint32_t checksum;      // Package checksum, 0 if not known yet
     bool is_installed;
 } game_registry_entry_t;
 
+// Registry row flags
+#define GAME_ENTRY_INSTALLED 0x01
+
+// Name index slot. entry is the registry index plus one, zero when empty.
+typedef struct {
+    uint32_t hash;
+    uint32_t entry;
+} game_index_slot_t;
+
+// Registry sort keys, also naming the maintained secondary orders
+typedef enum {
+    GAME_SORT_SIZE = 0,
+    GAME_SORT_LAST_PLAYED = 1,      // Most recently played first
+    GAME_SORT_TYPE = 2              // As an order, by type then recency
+} game_sort_key_t;
+
+// Read-only slice of a secondary order. ids are row indexes into the
+// snapshot the view was taken of and stay valid while it is held.
+typedef struct {
+    const uint32_t* ids;
+    uint32_t count;
+} game_registry_view_t;
+
+// Walks the rows of a snapshot, optionally filtered by type and required
+// flags
+typedef struct {
+    uint32_t next;
+    int type;               // Any type when negative
+    uint8_t flags;
+} game_registry_iter_t;
+
+// Header of the registry catalog, followed at GAME_CATALOG_DATA_OFFSET by
+// the registry's column block, which is used in place through a shared
+// mapping
+typedef struct {
+    uint32_t signature;
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t count;
+    uint32_t block_size;    // Depends on the row layout, so checked on open
+    uint32_t clean;         // Cleared while the catalog is open
+    uint32_t strings_used;
+    uint32_t string_count;
+    uint32_t data_checksum; // Of the column block, written when closed clean
+    uint32_t checksum;      // Of the fields above
+} game_catalog_header_t;
+
+// Game registry, stored as columns so scans over the hot fields never
+// touch names and paths. Rows are addressed by index; removing a row
+// moves the last row into its place. game_registry_entry_t is the row
+// form used to add and read entries.
+//
+// Names, authors and paths are interned: each is stored once in a string
+// arena and the columns hold its id, the offset in the arena. Strings
+// never move, so equal strings compare by id. Id 0 is the empty string.
+// Strings no row uses any more stay until the registry is rebuilt.
+typedef struct {
+    uint32_t count;
+    uint32_t capacity;
+    void* block;            // All columns and indexes share one allocation
+    
+    // Hot columns
+    uint8_t* types;
+    uint8_t* flags;
+    uint32_t* sizes;
+    uint32_t* last_played;
+    uint32_t* checksums;
+    
+    // Secondary orders of row indexes, kept sorted as rows change
+    uint32_t* by_size;
+    uint32_t* by_played;
+    uint32_t* by_type;
+    
+    // Cold columns, as string ids
+    uint32_t* names;
+    uint32_t* authors;
+    uint32_t* paths;
+    
+    // Open-addressing name indexes, exact and case-folded, each with
+    // twice as many slots as the capacity
+    game_index_slot_t* name_index;
+    game_index_slot_t* folded_index;
+    
+    // String arena and its open-addressing index by content, with four
+    // slots per row. At most three strings per row are interned.
+    char* strings;
+    uint32_t strings_size;
+    uint32_t strings_used;
+    uint32_t string_count;
+    game_index_slot_t* string_index;
+    
+    // Catalog file the block is mapped from, if attached
+    game_catalog_header_t* catalog;
+    size_t catalog_size;
+} game_registry_t;
+
+// What a directory scan last saw of a package file. name is the registry
+// entry it produced, empty when the package was invalid.
+typedef struct {
+    char path[MAX_PATH];
+    char name[MAX_GAME_NAME];
+    uint64_t mtime;
+    uint32_t size;
+    uint32_t checksum;
+    uint32_t generation;    // Scan that last saw the file
+} game_scan_entry_t;
+
+// Scan cache with an open-addressing index by path, capacity * 2 slots
+typedef struct {
+    game_scan_entry_t* entries;
+    game_index_slot_t* index;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t generation;
+    pthread_mutex_t lock;   // Held for a whole scan
+} game_scan_cache_t;
+
+// Directory under watch and its inotify watch descriptor
+typedef struct {
+    int wd;
+    char path[MAX_PATH];
+} game_watch_dir_t;
+
+// Watcher thread keeping the registry current with the host directories.
+// dirs belongs to the thread once it runs.
+typedef struct {
+    pthread_t thread;
+    bool running;
+    int fd;
+    int wake[2];
+    char root[MAX_PATH];
+    game_watch_dir_t* dirs;
+    uint32_t dir_count;
+    uint32_t dir_capacity;
+} game_watcher_t;
+
+// Documents of the search index that have been removed from the registry
+#define GAME_SEARCH_DELETED 0xFFFFFFFFu
+
+// Search key classes, in the top byte of a key
+#define GAME_SEARCH_KEY_TRIGRAM 0x01000000u
+#define GAME_SEARCH_KEY_PREFIX1 0x02000000u     // First character of a word
+#define GAME_SEARCH_KEY_PREFIX2 0x03000000u     // First two characters of a word
+
+// Documents carrying one search key, in ascending order
+typedef struct {
+    uint32_t key;           // 0 for an empty slot
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t* docs;
+} game_search_postings_t;
+
+// Typeahead index over registry names and authors. Documents are numbered
+// in the order rows were indexed and never renumbered, so removing a row
+// only marks its document deleted; the index is rebuilt once deleted
+// documents outnumber live ones.
+typedef struct {
+    bool built;             // Built as a write batch ends, then kept up to date
+    
+    // Postings by key, open addressing with a power-of-two capacity
+    game_search_postings_t* table;
+    uint32_t table_capacity;
+    uint32_t key_count;
+    
+    uint32_t* doc_rows;     // Document to registry row
+    uint32_t doc_count;
+    uint32_t doc_capacity;
+    uint32_t deleted;
+    uint32_t* row_docs;     // Registry row to document
+    uint32_t row_capacity;
+    
+} game_search_t;
+
+typedef struct {
+    uint32_t index;         // Registry row
+    uint32_t score;         // Higher is a better match
+} game_search_result_t;
+
+// Parts of a registry snapshot. Each is copied only when a batch changed
+// it and is otherwise shared with the snapshot before.
+#define GAME_SNAPSHOT_ROWS 0        // Name and string indexes, row columns, size order, strings
+#define GAME_SNAPSHOT_RECENCY 1     // Last played times and the orders that follow them
+#define GAME_SNAPSHOT_SEARCH 2      // Search postings and document rows
+#define GAME_SNAPSHOT_PARTS 3
+#define GAME_SNAPSHOT_ALL ((1u << GAME_SNAPSHOT_PARTS) - 1)
+
+// Shared part of a snapshot, followed by its data. Only writers count
+// references.
+typedef struct {
+    uint32_t refs;
+    uint32_t size;
+} game_snapshot_part_t;
+
+// Copy of the registry and its search index as a write batch left them.
+// Snapshots never change, so readers use them without locks for as long
+// as they hold them. Columns only hold the rows in use.
+typedef struct game_registry_snapshot {
+    game_registry_t registry;   // Columns point into the parts
+    game_search_t search;       // Postings and document rows only
+    game_snapshot_part_t* parts[GAME_SNAPSHOT_PARTS];
+    uint32_t sequence;          // Batch that published it
+    uint32_t pins;              // Readers holding it
+    struct game_registry_snapshot* next;    // In the retired list
+} game_registry_snapshot_t;
+
+// Read-copy-update over the registry. Writers serialize on the mutex and
+// change the registry in place, marking the snapshot parts they touch;
+// ending a batch publishes a new snapshot.
+// Readers take no locks and never wait: they pin the current snapshot,
+// counting themselves in acquiring while they do. Replaced snapshots are
+// retired and freed once unpinned, when no reader is acquiring.
+typedef struct {
+    pthread_mutex_t writer;
+    game_registry_snapshot_t* current;
+    uint32_t sequence;
+    uint32_t acquiring;
+    game_registry_snapshot_t* retired;
+    uint32_t dirty;         // Snapshot parts changed since the last publish
+    bool verify_pending;    // Catalog block adopted but not yet checked
+} game_registry_sync_t;
+
+// Pristine copy of a loaded image, kept after game_stop for fast relaunch
+typedef struct {
+    char path[MAX_PATH];
+    uint32_t checksum;
+    uint32_t package_size;  // File size, which with checksum identifies the package
+    game_header_t header;
+    game_header_ext_t header_ext;
+    uint32_t code_offset;
+    uint32_t data_offset;
+    void* code;
+    void* data;
+    game_section_t* sections;
+    uint32_t section_count;
+    uint32_t size;
+    uint32_t last_used;
+    uint32_t pins;
+    bool ready;
+} game_cached_image_t;
+
+// Relocated, executable code image shared by launches of the same title.
+// Relocations only refer to the code itself and to services at fixed
+// addresses, so a prelinked image stays valid for the life of the process.
+typedef struct {
+    char path[MAX_PATH];
+    uint32_t checksum;
+    void* base;
+    size_t size;
+    uint32_t refs;
+    uint32_t last_used;
+    bool ready;
+} game_module_t;
+
+// Memory-budgeted LRU cache of loaded images, guarded by io_lock
+typedef struct {
+    game_cached_image_t entries[GAME_IMAGE_CACHE_SLOTS];
+    uint32_t budget;
+    uint32_t used;
+    uint32_t clock;
+    uint32_t hits;
+    uint32_t misses;
+} game_image_cache_t;
+
 // Game manager context
 typedef struct {
     fs_context_t* fs;
     memory_manager_t* mm;
     
+    // Serializes file system and memory manager access between the game
+    // thread and background workers
+    pthread_mutex_t io_lock;
+    
     game_instance_t* current_game;
-    game_registry_entry_t registry[MAX_GAMES];
-    uint32_t game_count;
+    game_registry_t registry;
+    game_registry_sync_t registry_sync;
+    game_scan_cache_t scan_cache;
+    game_search_t search;
+    game_watcher_t watcher;
     
     // Runtime statistics
     uint32_t total_games_played;
@@ -115,11 +804,188 @@ typedef struct {
     uint32_t screen_width;
     uint32_t screen_height;
     
+    // Host directory backing the file system, used to map game images
+    char host_root[MAX_PATH];
+    
+    // Workers for parallel load-time work such as checksum verification
+    game_thread_pool_t pool;
+    
+    // Writes saves in the background
+    game_saver_t saver;
+    
+    // Recently loaded images, restored instead of re-read on relaunch
+    game_image_cache_t image_cache;
+    
+    // Prelinked code images, guarded by io_lock
+    game_module_t modules[GAME_MODULE_CACHE_SLOTS];
+    uint32_t module_clock;
+    
 } game_manager_t;
 
 // Game function pointer type
 typedef int (*game_main_func)(game_manager_t* gm, void* game_data);
 
+// Chunk hashing task of a checksum verifier
+typedef struct {
+    const uint8_t* data;
+    uint32_t size;
+    uint32_t index;
+    uint32_t* digest;
+    game_task_group_t* group;
+} game_hash_task_t;
+
+// Verifies a chunked image checksum as code and data arrive. Each section
+// is split into GAME_CHECKSUM_CHUNK_SIZE chunks that are hashed on the pool
+// as soon as they are complete; the image checksum combines the digests.
+typedef struct {
+    game_manager_t* gm;
+    game_task_group_t group;
+    uint32_t* digests;
+    game_hash_task_t* tasks;
+    uint32_t chunk_count;
+    uint32_t section_size[2];
+    uint32_t section_first[2];
+    uint32_t section_submitted[2];
+} game_verifier_t;
+
+// Random access reader over a package, using the host file when there is
+// one and re-reading through the file system otherwise
+typedef struct {
+    game_manager_t* gm;
+    char path[MAX_PATH];
+    int fd;
+    file_handle_t* file;
+    uint32_t position;
+} game_package_reader_t;
+
+// Package file found by a directory scan
+typedef struct {
+    char path[MAX_PATH];    // File system path
+    uint64_t mtime;
+    uint32_t size;
+} game_scan_file_t;
+
+// Lists one directory on the pool, collecting packages and subdirectories
+typedef struct {
+    game_manager_t* gm;
+    char path[MAX_PATH];
+    game_scan_file_t* files;
+    uint32_t file_count;
+    uint32_t file_capacity;
+    char (*dirs)[MAX_PATH];
+    uint32_t dir_count;
+    uint32_t dir_capacity;
+    game_task_group_t* group;
+} game_scan_task_t;
+
+typedef enum {
+    GAME_JOURNAL_INSTALL = 1,       // Move staged packages into place
+    GAME_JOURNAL_UNINSTALL = 2      // Delete packages and their rows
+} game_journal_operation_t;
+
+// Install journal header, followed by count package paths of MAX_PATH
+// bytes. A journal that made it to disk is rolled forward on the next
+// start; one that didn't leaves /games untouched.
+typedef struct {
+    uint32_t signature;
+    uint32_t operation;
+    uint32_t count;
+    uint32_t checksum;      // Of the paths
+} game_journal_header_t;
+
+// Copies one package into the staging directory on the pool
+typedef struct {
+    game_manager_t* gm;
+    const char* source;             // File system path
+    char staged[MAX_PATH];          // Host path
+    int status;
+    game_task_group_t* group;
+} game_install_task_t;
+
+// Read-ahead issued on the pool, with ranges resolved to package offsets
+typedef struct {
+    game_manager_t* gm;
+    int fd;
+    uint32_t range_count;
+    game_prefetch_range_t* ranges;
+} game_prefetch_task_t;
+
+// Header probe status
+typedef enum {
+    GAME_PROBE_OK = 0,
+    GAME_PROBE_UNREADABLE = 1,      // Missing, or too short for its header
+    GAME_PROBE_INVALID_HEADER = 2,
+    GAME_PROBE_INVALID_EXTENSION = 3
+} game_probe_status_t;
+
+// Compact summary of a probed package, enough to register it
+typedef struct {
+    uint32_t status;
+    uint32_t version;
+    game_type_t type;
+    uint32_t code_size;
+    uint32_t data_size;
+    uint32_t required_memory;
+    uint32_t save_data_size;
+    uint32_t checksum;
+    uint32_t file_size;     // Zero when the size is not known
+    char name[MAX_GAME_NAME];
+    char author[MAX_GAME_AUTHOR];
+} game_probe_result_t;
+
+// Raw header bytes gathered by a probe task, validated after the batch
+typedef struct {
+    game_header_t header;
+    game_header_ext_t ext;
+    uint32_t file_size;
+    uint32_t status;
+} game_probe_record_t;
+
+typedef struct {
+    game_manager_t* gm;
+    const char* const* paths;
+    game_probe_record_t* records;
+    uint32_t count;
+    game_task_group_t* group;
+} game_probe_task_t;
+
+// Flushes one file of a save group on the pool
+typedef struct {
+    int fd;
+    int result;
+    game_task_group_t* group;
+} game_save_sync_task_t;
+
+// Saves written by the saver but not yet durable. fds are the files to
+// flush, -1 for saves written through the fs layer; full saves go to a
+// temporary file that replaces the slot once flushed.
+typedef struct {
+    game_save_job_t* jobs[GAME_SAVE_GROUP_MAX];
+    int fds[GAME_SAVE_GROUP_MAX];
+    bool renames[GAME_SAVE_GROUP_MAX];
+    bool written[GAME_SAVE_GROUP_MAX];
+    bool deltas[GAME_SAVE_GROUP_MAX];
+    uint32_t count;
+} game_save_group_t;
+
+// Asynchronous load request, owned by the caller until game_load_finish
+typedef struct {
+    game_manager_t* gm;
+    game_registry_entry_t entry;
+    uint32_t flags;
+    pthread_t thread;
+    
+    // Shared with the loader thread, accessed atomically
+    uint32_t status;
+    uint32_t bytes_loaded;
+    uint32_t bytes_total;
+    uint32_t cancel_requested;
+    
+    game_load_progress_func progress;
+    void* user_data;
+    game_instance_t* game;
+} game_load_job_t;
+
 // Function prototypes
 int game_system_init(game_manager_t* gm, fs_context_t* fs, memory_manager_t* mm);
 int game_system_shutdown(game_manager_t* gm);
@@ -128,20 +994,195 @@ int game_system_shutdown(game_manager_t* gm);
 int game_install(game_manager_t* gm, const char* game_path);
 int game_uninstall(game_manager_t* gm, const char* game_name);
 int game_load(game_manager_t* gm, const char* game_name);
+int game_load_ex(game_manager_t* gm, const char* game_name, uint32_t flags);
+game_load_job_t* game_load_async(game_manager_t* gm, const char* game_name, uint32_t flags,
+                                 game_load_progress_func progress, void* user_data);
+game_load_status_t game_load_poll(game_load_job_t* job, uint32_t* bytes_loaded, uint32_t* bytes_total);
+void game_load_cancel(game_load_job_t* job);
+int game_load_finish(game_manager_t* gm, game_load_job_t* job);
 int game_run(game_manager_t* gm);
 int game_pause(game_manager_t* gm);
 int game_resume(game_manager_t* gm);
 int game_stop(game_manager_t* gm);
 
+// Post-init snapshots
+int game_init_complete(game_manager_t* gm, uint32_t resume_point);
+int game_restore_snapshot(game_manager_t* gm, game_instance_t* game);
+void game_snapshot_path(game_instance_t* game, char* path, size_t size);
+
+// Prefetch hints
+int game_prefetch_start(game_manager_t* gm, game_instance_t* game);
+void game_prefetch_record(game_instance_t* game, uint32_t section, uint32_t offset, uint32_t size);
+int game_prefetch_save(game_manager_t* gm, game_instance_t* game);
+void game_prefetch_path(game_instance_t* game, char* path, size_t size);
+
 // Save system
 int game_save(game_manager_t* gm, int slot);
 int game_load_save(game_manager_t* gm, int slot);
+void game_save_mark(game_manager_t* gm, uint32_t offset, uint32_t size);
+int game_save_set_compression(game_manager_t* gm, int slot, uint32_t compression);
+game_save_job_t* game_save_async(game_manager_t* gm, int slot, game_save_done_func done, void* user_data);
+game_save_status_t game_save_poll(game_save_job_t* job);
+int game_save_finish(game_manager_t* gm, game_save_job_t* job);
+void game_save_flush(game_manager_t* gm);
+int game_saver_start(game_manager_t* gm);
+void game_saver_stop(game_manager_t* gm);
 int game_list_saves(game_manager_t* gm, const char* game_name, save_game_t* saves, int max_saves);
 
-// Game registry
+// Game registry. Lookups, game_registry_get and game_list_installed may
+// run on any thread at any time and never wait. Row indexes, views and
+// iterators that must stay valid read a snapshot pinned with
+// game_registry_acquire. Everything that changes the registry belongs
+// between game_registry_write_begin and game_registry_write_end.
 int game_scan_directory(game_manager_t* gm, const char* directory);
 int game_list_installed(game_manager_t* gm, game_registry_entry_t* games, int max_games);
-game_registry_entry_t* game_find_by_name(game_manager_t* gm, const char* name);
+int game_find_by_name(game_manager_t* gm, const char* name);
+int game_find_by_name_nocase(game_manager_t* gm, const char* name);
+int game_registry_lookup(game_manager_t* gm, const char* name, game_registry_entry_t* entry);
+game_registry_snapshot_t* game_registry_acquire(game_manager_t* gm);
+void game_registry_release(game_manager_t* gm, game_registry_snapshot_t* snapshot);
+void game_registry_write_begin(game_manager_t* gm);
+int game_registry_write_end(game_manager_t* gm);
+int game_registry_add(game_manager_t* gm, const game_registry_entry_t* entry);
+int game_registry_remove(game_manager_t* gm, uint32_t index);
+int game_registry_get(game_manager_t* gm, uint32_t index, game_registry_entry_t* entry);
+int game_registry_reserve(game_manager_t* gm, uint32_t capacity);
+int game_registry_rebuild(game_manager_t* gm, uint32_t capacity, size_t string_bytes);
+void game_registry_free(game_manager_t* gm);
+int game_catalog_attach(game_manager_t* gm);
+int game_catalog_detach(game_manager_t* gm);
+void game_catalog_touch(game_registry_t* registry);
+uint32_t game_registry_select(const game_registry_snapshot_t* snapshot, int type, uint8_t flags,
+                              uint32_t* ids, uint32_t max_ids);
+int game_registry_sort(game_manager_t* gm, uint32_t* ids, uint32_t count, game_sort_key_t key);
+int game_registry_set_played(game_manager_t* gm, uint32_t index, uint32_t when);
+void game_registry_played(game_manager_t* gm, const game_registry_entry_t* entry, uint32_t when);
+int game_registry_view(const game_registry_snapshot_t* snapshot, game_sort_key_t order, game_registry_view_t* view);
+int game_registry_view_type(const game_registry_snapshot_t* snapshot, game_type_t type, game_registry_view_t* view);
+int game_registry_rebuild_orders(game_manager_t* gm);
+void game_registry_iter_init(game_registry_iter_t* iter, int type, uint8_t flags);
+int game_registry_iter_next(const game_registry_snapshot_t* snapshot, game_registry_iter_t* iter);
+int game_scan_lookup(game_manager_t* gm, const char* path);
+int game_scan_remember(game_manager_t* gm, const char* path);
+void game_scan_forget(game_manager_t* gm, uint32_t index);
+void game_scan_cache_free(game_manager_t* gm);
+uint32_t game_name_hash(const char* name, bool fold);
+void game_index_insert(game_index_slot_t* slots, uint32_t mask, uint32_t hash, uint32_t entry);
+void game_index_remove(game_index_slot_t* slots, uint32_t mask, uint32_t hash, uint32_t entry);
+
+// Installation
+int game_install_bulk(game_manager_t* gm, const char* const* paths, uint32_t count, int* results);
+int game_uninstall_bulk(game_manager_t* gm, const char* const* names, uint32_t count, int* results);
+int game_install_recover(game_manager_t* gm);
+
+// Live updates
+int game_scan_files(game_manager_t* gm, const char* const* paths, uint32_t count);
+int game_watch_start(game_manager_t* gm, const char* directory);
+void game_watch_stop(game_manager_t* gm);
+
+// Typeahead search
+int game_search(game_manager_t* gm, const char* query, game_search_result_t* results, uint32_t max_results);
+int game_search_in(const game_registry_snapshot_t* snapshot, const char* query, game_search_result_t* results,
+                   uint32_t max_results);
+int game_search_build(game_manager_t* gm);
+int game_search_add(game_manager_t* gm, uint32_t index);
+void game_search_remove(game_manager_t* gm, uint32_t index);
+void game_search_free(game_manager_t* gm);
+
+// Game image loading
+int game_set_host_root(game_manager_t* gm, const char* host_root);
+int game_host_path(game_manager_t* gm, const char* path, char* host_path, size_t size);
+game_instance_t* game_create_instance(game_manager_t* gm, game_registry_entry_t* entry,
+                                      uint32_t flags, game_load_job_t* job);
+void game_destroy_instance(game_manager_t* gm, game_instance_t* game);
+int game_read_image(game_manager_t* gm, game_registry_entry_t* entry, game_instance_t* game,
+                    game_load_job_t* job);
+int game_read_section(game_manager_t* gm, file_handle_t* file, void* buffer, uint32_t size,
+                      uint32_t stored_size, uint32_t compression, game_load_job_t* job,
+                      game_verifier_t* verifier, uint32_t section);
+int game_map_image(game_manager_t* gm, game_registry_entry_t* entry, game_instance_t* game);
+int game_map_section(game_manager_t* gm, int fd, off_t offset, uint32_t size, uint32_t stored_size,
+                     uint32_t compression, int prot, void** mapping, size_t* mapping_size, void** memory);
+void game_release_memory(game_manager_t* gm, game_instance_t* game);
+
+// Package format
+int game_read_header_ext(game_manager_t* gm, file_handle_t* file, game_header_t* header, game_header_ext_t* ext);
+int validate_game_header_ext(game_header_t* header, game_header_ext_t* ext);
+int validate_section_size(uint32_t size, uint32_t stored_size, uint32_t compression);
+int game_read_section_table(game_manager_t* gm, game_instance_t* game, file_handle_t* file, int fd);
+int game_parse_section_table(game_instance_t* game);
+int game_write_package(game_manager_t* gm, const char* path, const game_header_t* header,
+                       const void* code, const void* data, uint32_t compression);
+int game_write_package_ex(game_manager_t* gm, const char* path, const game_header_t* header,
+                          const void* code, const void* data, const game_package_section_t* extra,
+                          uint32_t extra_count, uint32_t compression);
+int game_reader_open(game_manager_t* gm, const char* path, game_package_reader_t* reader);
+int game_reader_read(game_package_reader_t* reader, uint32_t offset, void* buffer, uint32_t size);
+int game_reader_read_section(game_package_reader_t* reader, game_section_t* section, void* buffer);
+void game_reader_close(game_package_reader_t* reader);
+int game_probe_headers(game_manager_t* gm, const char* const* paths, uint32_t count,
+                       game_probe_result_t* results);
+int game_probe_read(game_manager_t* gm, const char* path, game_probe_record_t* record);
+
+// Native module loading
+int game_link_code(game_manager_t* gm, game_instance_t* game);
+int game_apply_relocations(game_manager_t* gm, game_instance_t* game, uint8_t* base);
+void* game_resolve_symbol(const char* name);
+int game_find_section_kind(game_instance_t* game, uint32_t kind);
+game_module_t* game_module_acquire(game_manager_t* gm, const char* path, uint32_t checksum);
+game_module_t* game_module_publish(game_manager_t* gm, const char* path, uint32_t checksum, void* base, size_t size);
+void game_module_release(game_manager_t* gm, game_module_t* module);
+void game_module_invalidate(game_manager_t* gm, const char* path);
+void game_module_clear(game_manager_t* gm);
+
+// Game assets
+void* game_asset_acquire(game_manager_t* gm, const char* name, uint32_t* size);
+int game_asset_release(game_manager_t* gm, const char* name);
+int game_find_section(game_instance_t* game, const char* name, uint32_t kind);
+int game_reserve_memory(game_manager_t* gm, game_instance_t* game, uint32_t size);
+int game_fs_skip(game_manager_t* gm, file_handle_t* file, uint32_t size);
+
+// Built-in LZ codec
+uint32_t game_lz_compress_bound(uint32_t size);
+uint32_t game_lz_compress(const void* src, uint32_t src_size, void* dst, uint32_t dst_capacity);
+void game_lz_stream_init(game_lz_stream_t* stream, void* dst, uint32_t dst_size);
+int game_lz_stream_feed(game_lz_stream_t* stream, const void* input, uint32_t size);
+int game_lz_copy_match(game_lz_stream_t* stream);
+int game_lz_stream_finish(game_lz_stream_t* stream);
+
+// Synchronized system access
+file_handle_t* game_fs_open(game_manager_t* gm, const char* path, uint32_t mode);
+uint32_t game_fs_read(game_manager_t* gm, file_handle_t* file, void* buffer, uint32_t size);
+uint32_t game_fs_write(game_manager_t* gm, file_handle_t* file, const void* buffer, uint32_t size);
+void game_fs_close(game_manager_t* gm, file_handle_t* file);
+void* game_mem_alloc(game_manager_t* gm, uint32_t size);
+void game_mem_free(game_manager_t* gm, void* ptr);
+
+// Image cache
+int game_cache_restore(game_manager_t* gm, game_registry_entry_t* entry, game_instance_t* game);
+void game_cache_store(game_manager_t* gm, game_registry_entry_t* entry, game_instance_t* game);
+void game_cache_invalidate(game_manager_t* gm, const char* path);
+void game_cache_set_budget(game_manager_t* gm, uint32_t budget);
+bool game_cache_evict_locked(game_manager_t* gm);
+void game_cache_clear(game_manager_t* gm);
+
+// Worker pool
+int game_pool_init(game_thread_pool_t* pool, uint32_t thread_count);
+void game_pool_submit(game_thread_pool_t* pool, game_task_func func, void* arg);
+void game_pool_shutdown(game_thread_pool_t* pool);
+void game_group_init(game_task_group_t* group);
+void game_group_add(game_task_group_t* group);
+void game_group_done(game_task_group_t* group);
+void game_group_wait(game_task_group_t* group);
+void game_group_destroy(game_task_group_t* group);
+
+// Image checksums
+int game_verifier_init(game_manager_t* gm, game_verifier_t* verifier, uint32_t code_size, uint32_t data_size);
+void game_verifier_advance(game_verifier_t* verifier, uint32_t section, const void* base, uint32_t available);
+uint32_t game_verifier_finish(game_verifier_t* verifier);
+uint32_t game_compute_checksum(game_manager_t* gm, const void* code, uint32_t code_size,
+                               const void* data, uint32_t data_size);
+uint32_t game_chunk_checksum(const void* data, uint32_t size, uint32_t index);
 
 // Utility functions
 uint32_t calculate_checksum(void* data, uint32_t size);
@@ -162,6 +1203,13 @@ int game_system_init(game_manager_t* gm, fs_context_t* fs, memory_manager_t* mm)
     
     gm->fs = fs;
     gm->mm = mm;
+    pthread_mutex_init(&gm->io_lock, NULL);
+    pthread_mutex_init(&gm->registry_sync.writer, NULL);
+    pthread_mutex_init(&gm->scan_cache.lock, NULL);
+    
+    gm->image_cache.budget = GAME_IMAGE_CACHE_BUDGET;
+    
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
     gm->max_game_memory = 16 * 1024 * 1024; // 16MB max per game
     gm->screen_width = 800;
     gm->screen_height = 600;
@@ -173,7 +1221,18 @@ int game_system_init(game_manager_t* gm, fs_context_t* fs, memory_manager_t* mm)
     
     if (!gm->framebuffer) {
         printf("Failed to allocate framebuffer\n");
-        return -1;
+        goto fail;
+    }
+    
+    // Threads start last, so the steps that can fail have nothing to stop
+    if (game_pool_init(&gm->pool, cpus > 1 ? (uint32_t)(cpus - 1) : 1) != 0) {
+        printf("Failed to start worker threads\n");
+        goto fail;
+    }
+    if (game_saver_start(gm) != 0) {
+        printf("Failed to start saver thread\n");
+        game_pool_shutdown(&gm->pool);
+        goto fail;
     }
     
     // Create games directory if it doesn't exist
@@ -187,55 +1246,100 @@ int game_system_init(game_manager_t* gm, fs_context_t* fs, memory_manager_t* mm)
     printf("Installing built-in demo games...\n");
     
     // Create demo game entries
-    game_registry_entry_t* pong = &gm->registry[gm->game_count++];
-    strcpy(pong->name, "Pong");
-    strcpy(pong->path, "builtin://pong");
-    pong->type = GAME_TYPE_ARCADE;
-    pong->size = 0;
-    pong->is_installed = true;
+    game_registry_entry_t pong;
+    memset(&pong, 0, sizeof(pong));
+    strcpy(pong.name, "Pong");
+    strcpy(pong.author, "Built-in");
+    strcpy(pong.path, "builtin://pong");
+    pong.type = GAME_TYPE_ARCADE;
+    pong.size = 0;
+    pong.is_installed = true;
+    
+    game_registry_entry_t tetris;
+    memset(&tetris, 0, sizeof(tetris));
+    strcpy(tetris.name, "Tetris");
+    strcpy(tetris.author, "Built-in");
+    strcpy(tetris.path, "builtin://tetris");
+    tetris.type = GAME_TYPE_PUZZLE;
+    tetris.size = 0;
+    tetris.is_installed = true;
     
-    game_registry_entry_t* tetris = &gm->registry[gm->game_count++];
-    strcpy(tetris->name, "Tetris");
-    strcpy(tetris->path, "builtin://tetris");
-    tetris->type = GAME_TYPE_PUZZLE;
-    tetris->size = 0;
-    tetris->is_installed = true;
+    game_registry_entry_t snake;
+    memset(&snake, 0, sizeof(snake));
+    strcpy(snake.name, "Snake");
+    strcpy(snake.author, "Built-in");
+    strcpy(snake.path, "builtin://snake");
+    snake.type = GAME_TYPE_ARCADE;
+    snake.size = 0;
+    snake.is_installed = true;
     
-    game_registry_entry_t* snake = &gm->registry[gm->game_count++];
-    strcpy(snake->name, "Snake");
-    strcpy(snake->path, "builtin://snake");
-    snake->type = GAME_TYPE_ARCADE;
-    snake->size = 0;
-    snake->is_installed = true;
+    game_registry_write_begin(gm);
+    game_registry_add(gm, &pong);
+    game_registry_add(gm, &tetris);
+    game_registry_add(gm, &snake);
+    if (game_registry_write_end(gm) != 0) {
+        game_saver_stop(gm);
+        game_pool_shutdown(&gm->pool);
+        game_registry_free(gm);
+        game_scan_cache_free(gm);
+        goto fail;
+    }
     
-    printf("Game system initialized with %d games\n", gm->game_count);
+    printf("Game system initialized with %d games\n", gm->registry.count);
     return 0;
+    
+fail:
+    if (gm->framebuffer) {
+        memory_free(mm, gm->framebuffer);
+        gm->framebuffer = NULL;
+    }
+    pthread_mutex_destroy(&gm->scan_cache.lock);
+    pthread_mutex_destroy(&gm->registry_sync.writer);
+    pthread_mutex_destroy(&gm->io_lock);
+    return -1;
 }
 
 int game_load(game_manager_t* gm, const char* game_name) {
+    return game_load_ex(gm, game_name, 0);
+}
+
+int game_load_ex(game_manager_t* gm, const char* game_name, uint32_t flags) {
     if (gm->current_game) {
         printf("Another game is already running. Stop it first.\n");
         return -1;
     }
     
     // Find game in registry
-    game_registry_entry_t* entry = game_find_by_name(gm, game_name);
-    if (!entry) {
+    game_registry_entry_t entry;
+    if (game_registry_lookup(gm, game_name, &entry) < 0) {
         printf("Game '%s' not found\n", game_name);
         return -1;
     }
     
+    gm->current_game = game_create_instance(gm, &entry, flags, NULL);
+    if (!gm->current_game) {
+        return -1;
+    }
+    
+    game_registry_played(gm, &entry, (uint32_t)time(NULL));
+    return 0;
+}
+
+// Builds a loaded instance for a registry entry. With a job the sections
+// are read with progress reporting and cancellation; the instance is only
+// returned once it is ready to run.
+game_instance_t* game_create_instance(game_manager_t* gm, game_registry_entry_t* entry,
+                                      uint32_t flags, game_load_job_t* job) {
     // Allocate game instance
-    gm->current_game = (game_instance_t*)memory_alloc(gm->mm, 
-        sizeof(game_instance_t), MEM_TYPE_GAME);
+    game_instance_t* game = (game_instance_t*)game_mem_alloc(gm, sizeof(game_instance_t));
     
-    if (!gm->current_game) {
+    if (!game) {
         printf("Failed to allocate memory for game instance\n");
-        return -1;
+        return NULL;
     }
     
-    game_instance_t* game = gm->current_game;
     memset(game, 0, sizeof(game_instance_t));
+    game->state = GAME_STATE_LOADING;
     
     // Handle built-in games
     if (strncmp(entry->path, "builtin://", 10) == 0) {
@@ -252,345 +1356,5906 @@ int game_load(game_manager_t* gm, const char* game_name) {
         game->header.save_data_size = 512;
         
         // Allocate memory for built-in game
-        game->data_memory = memory_alloc(gm->mm, game->header.data_size, MEM_TYPE_GAME);
+        game->data_memory = game_mem_alloc(gm, game->header.data_size);
         if (!game->data_memory) {
-            memory_free(gm->mm, game);
-            gm->current_game = NULL;
-            return -1;
+            game_mem_free(gm, game);
+            return NULL;
         }
+        game->resident_memory = game->header.data_size;
         
         printf("Loaded built-in game: %s\n", game->header.name);
-        game->state = GAME_STATE_LOADING;
-        return 0;
+        return game;
+    }
+    
+    strcpy(game->package_path, entry->path);
+    
+    // Map the image directly when requested, falling back to copying it
+    // through the file system if there is no host file to map. Copy loads
+    // are served from the image cache when the title was loaded recently.
+    int result = 1;
+    bool cached = false;
+    if (!(flags & GAME_LOAD_MAPPED) && game_cache_restore(gm, entry, game) == 0) {
+        cached = true;
+        result = 0;
+        if (job) {
+            uint32_t total = game->data_offset + game->header_ext.data_stored_size;
+            __atomic_store_n(&job->bytes_total, total, __ATOMIC_RELEASE);
+            __atomic_store_n(&job->bytes_loaded, total, __ATOMIC_RELEASE);
+        }
+    } else if (flags & GAME_LOAD_MAPPED) {
+        result = game_map_image(gm, entry, game);
+        if (result > 0) {
+            printf("No host image for %s, loading by copy\n", entry->path);
+        } else if (result == 0 && job) {
+            uint32_t total = game->data_offset + game->header_ext.data_stored_size;
+            __atomic_store_n(&job->bytes_total, total, __ATOMIC_RELEASE);
+            __atomic_store_n(&job->bytes_loaded, total, __ATOMIC_RELEASE);
+        }
+    }
+    if (result > 0) {
+        result = game_read_image(gm, entry, game, job);
+    }
+    
+    if (result != 0) {
+        game_destroy_instance(gm, game);
+        return NULL;
+    }
+    
+    // Keep a pristine copy before the game gets to modify its data
+    if (!cached && !(game->load_flags & GAME_LOAD_MAPPED)) {
+        game_cache_store(gm, entry, game);
+    }
+    
+    // Warm the ranges the game is known to read next
+    game->load_flags |= flags & GAME_LOAD_RECORD_PREFETCH;
+    game_prefetch_start(gm, game);
+    
+    // Move the code into an executable image
+    if (game_link_code(gm, game) != 0) {
+        printf("Failed to link game code\n");
+        game_destroy_instance(gm, game);
+        return NULL;
     }
     
+    // Skip the game's own initialization if it left a snapshot behind
+    if (game_restore_snapshot(gm, game) == 0) {
+        printf("Restored post-init snapshot\n");
+    }
+    
+    // Set up save path
+    snprintf(game->save_path, MAX_PATH, "/saves/%s", game->header.name);
+    
+    // Assets only count once they are acquired
+    game->resident_memory = game->header.code_size + game->header.data_size;
+    game->start_time = time(NULL);
+    
+    printf("Loaded game: %s by %s%s\n", game->header.name, game->header.author, cached ? " (cached)" : "");
+    printf("Memory %s: Code=%d, Data=%d\n", game->load_flags & GAME_LOAD_MAPPED ? "mapped" : "allocated",
+           game->header.code_size, game->header.data_size);
+    
+    return game;
+}
+
+void game_destroy_instance(game_manager_t* gm, game_instance_t* game) {
+    game_release_memory(gm, game);
+    game_mem_free(gm, game);
+}
+
+int game_read_image(game_manager_t* gm, game_registry_entry_t* entry, game_instance_t* game,
+                    game_load_job_t* job) {
     // Load game from file system
-    file_handle_t* game_file = fs_open(gm->fs, entry->path, 0x01); // Read mode
+    file_handle_t* game_file = game_fs_open(gm, entry->path, 0x01); // Read mode
     if (!game_file) {
         printf("Failed to open game file: %s\n", entry->path);
-        memory_free(gm->mm, game);
-        gm->current_game = NULL;
         return -1;
     }
     
+    game_verifier_t verifier;
+    game_verifier_t* active_verifier = NULL;
+    uint32_t position, code_gap, data_gap;
+    
     // Read game header
-    if (fs_read(gm->fs, game_file, &game->header, sizeof(game_header_t)) != sizeof(game_header_t)) {
+    if (game_fs_read(gm, game_file, &game->header, sizeof(game_header_t)) != sizeof(game_header_t)) {
         printf("Failed to read game header\n");
-        fs_close(game_file);
-        memory_free(gm->mm, game);
-        gm->current_game = NULL;
-        return -1;
+        goto fail;
     }
     
     // Validate game header
     if (validate_game_header(&game->header) != 0) {
         printf("Invalid game header\n");
-        fs_close(game_file);
-        memory_free(gm->mm, game);
-        gm->current_game = NULL;
-        return -1;
+        goto fail;
+    }
+    
+    if (game_read_header_ext(gm, game_file, &game->header, &game->header_ext) != 0 ||
+        validate_game_header_ext(&game->header, &game->header_ext) != 0) {
+        printf("Invalid game header extension\n");
+        goto fail;
     }
     
     // Check memory requirements
     if (game->header.required_memory > gm->max_game_memory) {
         printf("Game requires too much memory: %d bytes\n", game->header.required_memory);
-        fs_close(game_file);
-        memory_free(gm->mm, game);
-        gm->current_game = NULL;
-        return -1;
+        goto fail;
+    }
+    
+    if (game_read_section_table(gm, game, game_file, -1) != 0) {
+        printf("Invalid section table\n");
+        goto fail;
+    }
+    
+    // Asset sections are skipped here; they are read on first acquire
+    position = sizeof(game_header_t) + game->header_ext.ext_size +
+               game->section_count * sizeof(game_section_t);
+    code_gap = game->code_offset - position;
+    data_gap = game->data_offset - (game->code_offset + game->header_ext.code_stored_size);
+    
+    if (job) {
+        __atomic_store_n(&job->bytes_total, game->data_offset + game->header_ext.data_stored_size,
+                         __ATOMIC_RELEASE);
+        __atomic_store_n(&job->bytes_loaded, position, __ATOMIC_RELEASE);
     }
     
     // Allocate memory for game
-    game->code_memory = memory_alloc(gm->mm, game->header.code_size, MEM_TYPE_GAME);
-    game->data_memory = memory_alloc(gm->mm, game->header.data_size, MEM_TYPE_GAME);
+    game->code_memory = game_mem_alloc(gm, game->header.code_size);
+    game->data_memory = game_mem_alloc(gm, game->header.data_size);
     
     if (!game->code_memory || !game->data_memory) {
         printf("Failed to allocate memory for game\n");
-        if (game->code_memory) memory_free(gm->mm, game->code_memory);
-        if (game->data_memory) memory_free(gm->mm, game->data_memory);
-        fs_close(game_file);
-        memory_free(gm->mm, game);
-        gm->current_game = NULL;
-        return -1;
+        goto fail;
     }
     
-    // Read game code and data
-    if (fs_read(gm->fs, game_file, game->code_memory, game->header.code_size) != game->header.code_size) {
-        printf("Failed to read game code\n");
-        memory_free(gm->mm, game->code_memory);
-        memory_free(gm->mm, game->data_memory);
-        fs_close(game_file);
-        memory_free(gm->mm, game);
-        gm->current_game = NULL;
-        return -1;
+    // Chunks are hashed on the worker pool while the next ones are read
+    if (game->header_ext.checksum_type == GAME_CHECKSUM_CHUNKED) {
+        if (game_verifier_init(gm, &verifier, game->header.code_size, game->header.data_size) != 0) {
+            printf("Failed to start checksum verification\n");
+            goto fail;
+        }
+        active_verifier = &verifier;
     }
     
-    if (fs_read(gm->fs, game_file, game->data_memory, game->header.data_size) != game->header.data_size) {
-        printf("Failed to read game data\n");
-        memory_free(gm->mm, game->code_memory);
-        memory_free(gm->mm, game->data_memory);
-        fs_close(game_file);
-        memory_free(gm->mm, game);
-        gm->current_game = NULL;
-        return -1;
+    // Read game code and data, decompressing as the chunks arrive
+    if (game_fs_skip(gm, game_file, code_gap) != 0 ||
+        game_read_section(gm, game_file, game->code_memory, game->header.code_size,
+                          game->header_ext.code_stored_size, game->header_ext.code_compression, job,
+                          active_verifier, 0) != 0) {
+        printf("Failed to read game code\n");
+        goto fail;
     }
     
-    fs_close(game_file);
+    if (job) {
+        __atomic_add_fetch(&job->bytes_loaded, code_gap + data_gap, __ATOMIC_ACQ_REL);
+    }
     
-    // Set up save path
-    snprintf(game->save_path, MAX_PATH, "/saves/%s", game->header.name);
+    if (game_fs_skip(gm, game_file, data_gap) != 0 ||
+        game_read_section(gm, game_file, game->data_memory, game->header.data_size,
+                          game->header_ext.data_stored_size, game->header_ext.data_compression, job,
+                          active_verifier, 1) != 0) {
+        printf("Failed to read game data\n");
+        goto fail;
+    }
     
-    game->state = GAME_STATE_LOADING;
-    game->start_time = time(NULL);
+    game_fs_close(gm, game_file);
+    game_file = NULL;
     
-    printf("Loaded game: %s by %s\n", game->header.name, game->header.author);
-    printf("Memory allocated: Code=%d, Data=%d\n", game->header.code_size, game->header.data_size);
+    if (active_verifier) {
+        active_verifier = NULL;
+        if (game_verifier_finish(&verifier) != game->header.checksum) {
+            printf("Checksum mismatch: %s is corrupt\n", entry->path);
+            return -1;
+        }
+    }
     
+    game->load_flags &= ~GAME_LOAD_MAPPED;
     return 0;
+    
+fail:
+    // Outstanding hash tasks still read the section buffers
+    if (active_verifier) {
+        game_verifier_finish(active_verifier);
+    }
+    game_fs_close(gm, game_file);
+    return -1;
 }
 
-int game_run(game_manager_t* gm) {
-    if (!gm->current_game) {
-        printf("No game loaded\n");
-        return -1;
-    }
-    
-    game_instance_t* game = gm->current_game;
+// Reads a section in GAME_LOAD_CHUNK_SIZE pieces, taking the I/O lock per
+// chunk so the game thread is never held off for a whole section.
+// Compressed sections are staged one chunk at a time and decoded straight
+// into the destination, so the full compressed section is never buffered.
+int game_read_section(game_manager_t* gm, file_handle_t* file, void* buffer, uint32_t size,
+                      uint32_t stored_size, uint32_t compression, game_load_job_t* job,
+                      game_verifier_t* verifier, uint32_t section) {
+    uint8_t* staging = NULL;
+    game_lz_stream_t stream;
     
-    if (game->state != GAME_STATE_LOADING && game->state != GAME_STATE_PAUSED) {
-        printf("Game is not in a runnable state\n");
-        return -1;
+    if (compression == GAME_COMPRESSION_LZ) {
+        staging = (uint8_t*)game_mem_alloc(gm, GAME_LOAD_CHUNK_SIZE);
+        if (!staging) {
+            printf("Failed to allocate staging buffer\n");
+            return -1;
+        }
+        game_lz_stream_init(&stream, buffer, size);
     }
     
-    game->state = GAME_STATE_RUNNING;
-    printf("Running game: %s\n", game->header.name);
-    
-    // Game main loop
+    uint8_t* bytes = (uint8_t*)buffer;
+    uint32_t offset = 0;
     int result = 0;
     
-    // Handle built-in games
-    if (strcmp(game->header.name, "Pong") == 0) {
-        result = demo_game_pong(gm, game->data_memory);
-    } else if (strcmp(game->header.name, "Tetris") == 0) {
-        result = demo_game_tetris(gm, game->data_memory);
-    } else if (strcmp(game->header.name, "Snake") == 0) {
-        result = demo_game_snake(gm, game->data_memory);
-    } else {
-        // Execute loaded game code
-        if (game->code_memory && game->header.entry_point) {
-            game_main_func main_func = (game_main_func)((char*)game->code_memory + game->header.entry_point);
-            result = main_func(gm, game->data_memory);
-        } else {
-            printf("No executable code found\n");
+    while (offset < stored_size) {
+        if (job && __atomic_load_n(&job->cancel_requested, __ATOMIC_ACQUIRE)) {
+            printf("Load cancelled\n");
+            result = -1;
+            break;
+        }
+        
+        uint32_t chunk = stored_size - offset < GAME_LOAD_CHUNK_SIZE ? stored_size - offset : GAME_LOAD_CHUNK_SIZE;
+        uint8_t* target = staging ? staging : bytes + offset;
+        if (game_fs_read(gm, file, target, chunk) != chunk) {
             result = -1;
+            break;
+        }
+        if (staging && game_lz_stream_feed(&stream, staging, chunk) != 0) {
+            printf("Corrupt compressed section\n");
+            result = -1;
+            break;
+        }
+        offset += chunk;
+        
+        if (verifier) {
+            game_verifier_advance(verifier, section, buffer, staging ? stream.out_pos : offset);
+        }
+        
+        if (job) {
+            uint32_t loaded = __atomic_add_fetch(&job->bytes_loaded, chunk, __ATOMIC_ACQ_REL);
+            if (job->progress) {
+                job->progress(loaded, __atomic_load_n(&job->bytes_total, __ATOMIC_ACQUIRE), job->user_data);
+            }
         }
     }
     
-    // Update play time
-    update_play_time(gm);
-    
-    if (result == 0) {
-        printf("Game completed successfully\n");
-    } else {
-        printf("Game ended with error code: %d\n", result);
-        game->state = GAME_STATE_ERROR;
+    if (staging) {
+        if (result == 0 && game_lz_stream_finish(&stream) != 0) {
+            printf("Compressed section is truncated\n");
+            result = -1;
+        }
+        game_mem_free(gm, staging);
     }
     
     return result;
 }
 
-int game_stop(game_manager_t* gm) {
-    if (!gm->current_game) {
-        return 0;
-    }
+static void* game_load_worker(void* arg) {
+    game_load_job_t* job = (game_load_job_t*)arg;
     
-    game_instance_t* game = gm->current_game;
+    job->game = game_create_instance(job->gm, &job->entry, job->flags, job);
     
-    printf("Stopping game: %s\n", game->header.name);
+    uint32_t status = GAME_LOAD_DONE;
+    if (!job->game) {
+        status = __atomic_load_n(&job->cancel_requested, __ATOMIC_ACQUIRE) ?
+                 GAME_LOAD_CANCELLED : GAME_LOAD_FAILED;
+    }
+    __atomic_store_n(&job->status, status, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+// Starts loading a game on an I/O worker thread and returns immediately.
+// The caller polls the job (or watches the progress callback) and must
+// always hand it back through game_load_finish.
+game_load_job_t* game_load_async(game_manager_t* gm, const char* game_name, uint32_t flags,
+                                 game_load_progress_func progress, void* user_data) {
+    game_registry_entry_t entry;
+    if (game_registry_lookup(gm, game_name, &entry) < 0) {
+        printf("Game '%s' not found\n", game_name);
+        return NULL;
+    }
     
-    // Update statistics
-    update_play_time(gm);
-    gm->total_games_played++;
-    gm->total_play_time += game->play_time;
+    game_load_job_t* job = (game_load_job_t*)game_mem_alloc(gm, sizeof(game_load_job_t));
+    if (!job) {
+        printf("Failed to allocate load job\n");
+        return NULL;
+    }
+    
+    memset(job, 0, sizeof(game_load_job_t));
+    job->gm = gm;
+    job->entry = entry;
+    job->flags = flags;
+    job->status = GAME_LOAD_RUNNING;
+    job->progress = progress;
+    job->user_data = user_data;
     
-    // Free game memory
-    if (game->code_memory) {
-        memory_free(gm->mm, game->code_memory);
+    if (pthread_create(&job->thread, NULL, game_load_worker, job) != 0) {
+        printf("Failed to start loader thread\n");
+        game_mem_free(gm, job);
+        return NULL;
     }
-    if (game->data_memory) {
-        memory_free(gm->mm, game->data_memory);
+    
+    return job;
+}
+
+game_load_status_t game_load_poll(game_load_job_t* job, uint32_t* bytes_loaded, uint32_t* bytes_total) {
+    if (bytes_loaded) {
+        *bytes_loaded = __atomic_load_n(&job->bytes_loaded, __ATOMIC_ACQUIRE);
     }
-    if (game->stack_memory) {
-        memory_free(gm->mm, game->stack_memory);
+    if (bytes_total) {
+        *bytes_total = __atomic_load_n(&job->bytes_total, __ATOMIC_ACQUIRE);
     }
+    return (game_load_status_t)__atomic_load_n(&job->status, __ATOMIC_ACQUIRE);
+}
+
+void game_load_cancel(game_load_job_t* job) {
+    __atomic_store_n(&job->cancel_requested, 1, __ATOMIC_RELEASE);
+}
+
+// Waits for the loader thread and releases the job. A successfully loaded
+// game becomes the current game; anything else is torn down.
+int game_load_finish(game_manager_t* gm, game_load_job_t* job) {
+    pthread_join(job->thread, NULL);
     
-    // Free game instance
-    memory_free(gm->mm, game);
-    gm->current_game = NULL;
+    game_instance_t* game = job->game;
+    int result = -1;
     
-    printf("Game stopped and memory freed\n");
-    return 0;
+    if (game && __atomic_load_n(&job->cancel_requested, __ATOMIC_ACQUIRE)) {
+        game_destroy_instance(gm, game);
+    } else if (game && gm->current_game) {
+        printf("Another game is already running. Stop it first.\n");
+        game_destroy_instance(gm, game);
+    } else if (game) {
+        gm->current_game = game;
+        result = 0;
+        game_registry_played(gm, &job->entry, (uint32_t)time(NULL));
+    }
+    
+    game_mem_free(gm, job);
+    return result;
 }
 
-int game_save(game_manager_t* gm, int slot) {
-    if (!gm->current_game || slot < 0 || slot >= MAX_SAVE_SLOTS) {
+// Maps the code and data segments of a package straight from the host file.
+// Both mappings are private: code is read-only and data pages are copied on
+// first write, so nothing is ever written back and clean pages stay shared in
+// the page cache between launches of the same title.
+// Returns 1 if the package has no host file to map.
+int game_map_image(game_manager_t* gm, game_registry_entry_t* entry, game_instance_t* game) {
+    char host_path[MAX_PATH];
+    if (game_host_path(gm, entry->path, host_path, sizeof(host_path)) != 0) {
+        return 1;
+    }
+    
+    int fd = open(host_path, O_RDONLY);
+    if (fd < 0) {
+        return 1;
+    }
+    
+    if (pread(fd, &game->header, sizeof(game_header_t), 0) != (ssize_t)sizeof(game_header_t)) {
+        printf("Failed to read game header\n");
+        close(fd);
         return -1;
     }
     
-    game_instance_t* game = gm->current_game;
+    if (validate_game_header(&game->header) != 0) {
+        printf("Invalid game header\n");
+        close(fd);
+        return -1;
+    }
     
-    // Create save file path
-    char save_path[MAX_PATH];
-    snprintf(save_path, MAX_PATH, "%s_slot_%d.sav", game->save_path, slot);
+    game_header_ext_t* ext = &game->header_ext;
+    memset(ext, 0, sizeof(game_header_ext_t));
+    if (game->header.version >= GAME_VERSION_EXTENDED) {
+        ssize_t length = pread(fd, ext, sizeof(game_header_ext_t), sizeof(game_header_t));
+        if (length < GAME_HEADER_EXT_MIN_SIZE) {
+            printf("Failed to read game header extension\n");
+            close(fd);
+            return -1;
+        }
+        if (ext->ext_size < sizeof(game_header_ext_t)) {
+            memset((char*)ext + ext->ext_size, 0, sizeof(game_header_ext_t) - ext->ext_size);
+        }
+    } else {
+        ext->code_stored_size = game->header.code_size;
+        ext->data_stored_size = game->header.data_size;
+    }
     
-    // Create save data
-    save_game_t save_data;
-    save_data.signature = SAVE_SIGNATURE;
-    save_data.game_checksum = game->header.checksum;
-    save_data.save_time = time(NULL);
-    save_data.play_time = game->play_time;
-    save_data.level = game->current_level;
-    save_data.score = game->current_score;
-    save_data.data_size = game->header.save_data_size;
-    
-    // Copy game-specific save data (simplified)
-    memcpy(save_data.save_data, game->data_memory, 
-           game->header.save_data_size < 4096 ? game->header.save_data_size : 4096);
-    
-    // Write save file
-    file_handle_t* save_file = fs_open(gm->fs, save_path, 0x02); // Write mode
-    if (!save_file) {
-        printf("Failed to create save file: %s\n", save_path);
+    if (validate_game_header_ext(&game->header, ext) != 0) {
+        printf("Invalid game header extension\n");
+        close(fd);
         return -1;
     }
     
-    if (fs_write(gm->fs, save_file, &save_data, sizeof(save_game_t)) != sizeof(save_game_t)) {
-        printf("Failed to write save data\n");
-        fs_close(save_file);
+    if (game->header.required_memory > gm->max_game_memory) {
+        printf("Game requires too much memory: %d bytes\n", game->header.required_memory);
+        close(fd);
         return -1;
     }
     
-    fs_close(save_file);
+    if (game_read_section_table(gm, game, NULL, fd) != 0) {
+        printf("Invalid section table\n");
+        close(fd);
+        return -1;
+    }
     
-    game->has_save_data = true;
-    printf("Game saved to slot %d\n", slot);
-    return 0;
-}
-
-game_registry_entry_t* game_find_by_name(game_manager_t* gm, const char* name) {
-    for (uint32_t i = 0; i < gm->game_count; i++) {
-        if (strcmp(gm->registry[i].name, name) == 0) {
-            return &gm->registry[i];
-        }
+    // Touching a mapping past the end of the file raises SIGBUS, so refuse
+    // truncated images up front
+    off_t code_offset = game->code_offset;
+    off_t data_offset = game->data_offset;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < data_offset + (off_t)ext->data_stored_size) {
+        printf("Game image is truncated: %s\n", entry->path);
+        close(fd);
+        return -1;
     }
-    return NULL;
-}
-
-int validate_game_header(game_header_t* header) {
-    if (header->signature != GAME_SIGNATURE) {
-        printf("Invalid game signature\n");
+    
+    if (game_map_section(gm, fd, code_offset, game->header.code_size, ext->code_stored_size,
+                         ext->code_compression, PROT_READ,
+                         &game->code_mapping, &game->code_mapping_size, &game->code_memory) != 0) {
+        printf("Failed to map game code\n");
+        close(fd);
         return -1;
     }
     
-    if (header->version == 0) {
-        printf("Invalid game version\n");
+    if (game_map_section(gm, fd, data_offset, game->header.data_size, ext->data_stored_size,
+                         ext->data_compression, PROT_READ | PROT_WRITE,
+                         &game->data_mapping, &game->data_mapping_size, &game->data_memory) != 0) {
+        printf("Failed to map game data\n");
+        close(fd);
         return -1;
     }
     
-    if (header->code_size == 0 && header->data_size == 0) {
-        printf("Game has no code or data\n");
+    // Hashing faults the mapped pages in, spread across the worker pool
+    if (ext->checksum_type == GAME_CHECKSUM_CHUNKED &&
+        game_compute_checksum(gm, game->code_memory, game->header.code_size,
+                              game->data_memory, game->header.data_size) != game->header.checksum) {
+        printf("Checksum mismatch: %s is corrupt\n", entry->path);
+        close(fd);
         return -1;
     }
     
+    // The mappings keep their own reference to the file
+    close(fd);
+    game->load_flags |= GAME_LOAD_MAPPED;
     return 0;
 }
 
-void update_play_time(game_manager_t* gm) {
-    if (gm->current_game) {
-        uint32_t current_time = time(NULL);
-        gm->current_game->play_time = current_time - gm->current_game->start_time;
+// Maps one section privately at its file offset. Compressed sections can't
+// be used in place, so they are decoded from a transient read-only mapping
+// into allocated memory instead.
+int game_map_section(game_manager_t* gm, int fd, off_t offset, uint32_t size, uint32_t stored_size,
+                     uint32_t compression, int prot, void** mapping, size_t* mapping_size, void** memory) {
+    if (size == 0) {
+        return 0;
     }
-}
-
-// Demo game implementations
-int demo_game_pong(game_manager_t* gm, void* game_data) {
-    printf("=== PONG ===\n");
-    printf("Classic Pong game simulation\n");
-    printf("Player 1: 5 | Player 2: 3\n");
-    printf("Game Over - Player 1 Wins!\n");
     
-    // Simulate game running for a bit
-    for (int i = 0; i < 1000000; i++) {
-        // Simulate game logic
-        if (i % 100000 == 0) {
-            printf("Game frame %d\n", i / 100000);
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    off_t map_offset = offset & ~(off_t)(page_size - 1);
+    size_t delta = (size_t)(offset - map_offset);
+    size_t length = delta + stored_size;
+    
+    if (compression == GAME_COMPRESSION_NONE) {
+        void* base = mmap(NULL, length, prot, MAP_PRIVATE, fd, map_offset);
+        if (base == MAP_FAILED) {
+            return -1;
         }
+        *mapping = base;
+        *mapping_size = length;
+        *memory = (char*)base + delta;
+        return 0;
     }
     
-    gm->current_game->current_score = 5;
-    gm->current_game->current_level = 1;
-    
-    return 0;
-}
-
-int demo_game_tetris(game_manager_t* gm, void* game_data) {
-    printf("=== TETRIS ===\n");
-    printf("Block puzzle game simulation\n");
-    printf("Lines cleared: 15\n");
-    printf("Level: 3\n");
-    printf("Score: 12450\n");
+    *memory = game_mem_alloc(gm, size);
+    if (!*memory) {
+        return -1;
+    }
     
-    // Simulate game running
-    for (int i = 0; i < 1500000; i++) {
-        if (i % 150000 == 0) {
-            printf("Piece %d placed\n", i / 150000);
-        }
+    void* base = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, map_offset);
+    if (base == MAP_FAILED) {
+        return -1;
     }
     
-    gm->current_game->current_score = 12450;
-    gm->current_game->current_level = 3;
+    game_lz_stream_t stream;
+    game_lz_stream_init(&stream, *memory, size);
+    int result = game_lz_stream_feed(&stream, (char*)base + delta, stored_size);
+    if (result == 0) {
+        result = game_lz_stream_finish(&stream);
+    }
+    munmap(base, length);
     
-    return 0;
+    if (result != 0) {
+        printf("Corrupt compressed section\n");
+    }
+    return result;
 }
 
-int demo_game_snake(game_manager_t* gm, void* game_data) {
-    printf("=== SNAKE ===\n");
-    printf("Snake game simulation\n");
-    printf("Length: 8\n");
-    printf("Score: 80\n");
-    printf("Game Over - Snake hit wall!\n");
+void game_release_memory(game_manager_t* gm, game_instance_t* game) {
+    if (game->module) {
+        game_module_release(gm, (game_module_t*)game->module);
+        game->module = NULL;
+    } else if (game->code_mapping) {
+        munmap(game->code_mapping, game->code_mapping_size);
+    } else if (game->code_memory) {
+        game_mem_free(gm, game->code_memory);
+    }
+    if (game->data_mapping) {
+        munmap(game->data_mapping, game->data_mapping_size);
+    } else if (game->data_memory) {
+        game_mem_free(gm, game->data_memory);
+    }
+    if (game->stack_memory) {
+        game_mem_free(gm, game->stack_memory);
+    }
+    if (game->assets) {
+        for (uint32_t i = 0; i < game->section_count; i++) {
+            if (game->assets[i].memory) {
+                game_mem_free(gm, game->assets[i].memory);
+            }
+        }
+        game_mem_free(gm, game->assets);
+    }
+    if (game->sections) {
+        game_mem_free(gm, game->sections);
+    }
+    if (game->prefetch_log) {
+        game_mem_free(gm, game->prefetch_log);
+    }
+    if (game->save_dirty) {
+        game_mem_free(gm, game->save_dirty);
+    }
+    if (game->save_shadow) {
+        game_mem_free(gm, game->save_shadow);
+    }
+    
+    game->sections = NULL;
+    game->assets = NULL;
+    game->section_count = 0;
+    game->resident_memory = 0;
+    game->code_memory = NULL;
+    game->data_memory = NULL;
+    game->stack_memory = NULL;
+    game->code_mapping = NULL;
+    game->data_mapping = NULL;
+    game->prefetch_log = NULL;
+    game->prefetch_count = 0;
+    game->save_dirty = NULL;
+    game->save_shadow = NULL;
+    game->save_slot = 0;
+}
+
+// Reads the header extension following a GAME_VERSION_EXTENDED header.
+// Basic packages get an equivalent extension describing raw sections.
+int game_read_header_ext(game_manager_t* gm, file_handle_t* file, game_header_t* header, game_header_ext_t* ext) {
+    memset(ext, 0, sizeof(game_header_ext_t));
+    
+    if (header->version < GAME_VERSION_EXTENDED) {
+        ext->code_stored_size = header->code_size;
+        ext->data_stored_size = header->data_size;
+        return 0;
+    }
+    
+    if (game_fs_read(gm, file, &ext->ext_size, sizeof(uint32_t)) != sizeof(uint32_t) ||
+        ext->ext_size < GAME_HEADER_EXT_MIN_SIZE) {
+        return -1;
+    }
+    
+    // Fields added after this package was written stay zero, and fields
+    // from newer writers are skipped
+    uint32_t known = ext->ext_size < sizeof(game_header_ext_t) ? ext->ext_size : sizeof(game_header_ext_t);
+    uint32_t remaining = known - sizeof(uint32_t);
+    if (game_fs_read(gm, file, (char*)ext + sizeof(uint32_t), remaining) != remaining) {
+        return -1;
+    }
+    
+    return game_fs_skip(gm, file, ext->ext_size - known);
+}
+
+int validate_game_header_ext(game_header_t* header, game_header_ext_t* ext) {
+    uint32_t compression[2] = { ext->code_compression, ext->data_compression };
+    uint32_t size[2] = { header->code_size, header->data_size };
+    uint32_t stored_size[2] = { ext->code_stored_size, ext->data_stored_size };
+    
+    for (int i = 0; i < 2; i++) {
+        if (validate_section_size(size[i], stored_size[i], compression[i]) != 0) {
+            return -1;
+        }
+    }
+    
+    if (ext->section_count > MAX_GAME_SECTIONS ||
+        (ext->section_count > 0 && header->version < GAME_VERSION_SECTIONS)) {
+        printf("Invalid section count: %d\n", ext->section_count);
+        return -1;
+    }
+    
+    return 0;
+}
+
+int validate_section_size(uint32_t size, uint32_t stored_size, uint32_t compression) {
+    if (compression == GAME_COMPRESSION_NONE) {
+        if (stored_size != size) {
+            printf("Stored section size does not match\n");
+            return -1;
+        }
+    } else if (compression == GAME_COMPRESSION_LZ) {
+        if ((size > 0 && stored_size == 0) || stored_size > game_lz_compress_bound(size)) {
+            printf("Invalid compressed section size\n");
+            return -1;
+        }
+    } else {
+        printf("Unknown section compression: %d\n", compression);
+        return -1;
+    }
+    
+    return 0;
+}
+
+// Reads the section directory that follows the header extension, from the
+// open file or, when file is NULL, from the host descriptor. Packages
+// without a directory get sequential code and data offsets.
+int game_read_section_table(game_manager_t* gm, game_instance_t* game, file_handle_t* file, int fd) {
+    uint32_t table_offset = sizeof(game_header_t) + game->header_ext.ext_size;
+    uint32_t count = game->header_ext.section_count;
+    
+    if (count == 0) {
+        game->code_offset = table_offset;
+        game->data_offset = table_offset + game->header_ext.code_stored_size;
+        return 0;
+    }
+    
+    uint32_t table_size = count * sizeof(game_section_t);
+    game->sections = (game_section_t*)game_mem_alloc(gm, table_size);
+    game->assets = (game_asset_t*)game_mem_alloc(gm, count * sizeof(game_asset_t));
+    if (!game->sections || !game->assets) {
+        printf("Failed to allocate section table\n");
+        return -1;
+    }
+    game->section_count = count;
+    memset(game->assets, 0, count * sizeof(game_asset_t));
+    
+    if (file) {
+        if (game_fs_read(gm, file, game->sections, table_size) != table_size) {
+            return -1;
+        }
+    } else if (pread(fd, game->sections, table_size, table_offset) != (ssize_t)table_size) {
+        return -1;
+    }
+    
+    return game_parse_section_table(game);
+}
+
+// Checks the directory and takes the code and data layout from it. Code
+// and data must follow the directory in order so they can still be loaded
+// in a single sequential pass; assets may live anywhere after it.
+int game_parse_section_table(game_instance_t* game) {
+    uint32_t table_end = sizeof(game_header_t) + game->header_ext.ext_size +
+                         game->section_count * sizeof(game_section_t);
+    game_section_t* code = NULL;
+    game_section_t* data = NULL;
+    
+    for (uint32_t i = 0; i < game->section_count; i++) {
+        game_section_t* section = &game->sections[i];
+        
+        if (section->name[GAME_SECTION_NAME - 1] != '\0' ||
+            section->offset < table_end ||
+            section->offset + section->stored_size < section->offset ||
+            validate_section_size(section->size, section->stored_size, section->compression) != 0) {
+            return -1;
+        }
+        
+        if (section->kind == GAME_SECTION_CODE) {
+            if (code) return -1;
+            code = section;
+        } else if (section->kind == GAME_SECTION_DATA) {
+            if (data) return -1;
+            data = section;
+        } else if (section->kind != GAME_SECTION_ASSET && section->kind != GAME_SECTION_RELOCS &&
+                   section->kind != GAME_SECTION_IMPORTS && section->kind != GAME_SECTION_PREFETCH) {
+            return -1;
+        }
+    }
+    
+    if (!code || !data ||
+        code->size != game->header.code_size || data->size != game->header.data_size ||
+        data->offset < code->offset + code->stored_size) {
+        return -1;
+    }
+    
+    game->header_ext.code_compression = code->compression;
+    game->header_ext.code_stored_size = code->stored_size;
+    game->header_ext.data_compression = data->compression;
+    game->header_ext.data_stored_size = data->stored_size;
+    game->code_offset = code->offset;
+    game->data_offset = data->offset;
+    return 0;
+}
+
+// Writes a package in the extended format. With GAME_COMPRESSION_LZ each
+// section is compressed, but kept raw if compression doesn't shrink it.
+int game_write_package(game_manager_t* gm, const char* path, const game_header_t* header,
+                       const void* code, const void* data, uint32_t compression) {
+    return game_write_package_ex(gm, path, header, code, data, NULL, 0, compression);
+}
+
+// Packages with extra sections (assets, relocations, imports) are written
+// with a section directory, placing code and data first and the rest after.
+int game_write_package_ex(game_manager_t* gm, const char* path, const game_header_t* header,
+                          const void* code, const void* data, const game_package_section_t* extra,
+                          uint32_t extra_count, uint32_t compression) {
+    if (extra_count > MAX_GAME_SECTIONS - 2) {
+        printf("Too many sections: %d\n", extra_count);
+        return -1;
+    }
+    
+    uint32_t count = extra_count + 2;
+    uint32_t directory_count = extra_count > 0 ? count : 0;
+    
+    game_header_t out_header = *header;
+    out_header.version = directory_count ? GAME_VERSION_SECTIONS : GAME_VERSION_EXTENDED;
+    
+    game_header_ext_t ext;
+    memset(&ext, 0, sizeof(game_header_ext_t));
+    ext.ext_size = sizeof(game_header_ext_t);
+    ext.section_count = directory_count;
+    
+    game_section_t* table = (game_section_t*)game_mem_alloc(gm, count * sizeof(game_section_t));
+    const void** payloads = (const void**)game_mem_alloc(gm, count * sizeof(void*));
+    void** packed = (void**)game_mem_alloc(gm, count * sizeof(void*));
+    int result = -1;
+    
+    if (!table || !payloads || !packed) {
+        printf("Failed to allocate package tables\n");
+        goto cleanup;
+    }
+    memset(table, 0, count * sizeof(game_section_t));
+    memset(packed, 0, count * sizeof(void*));
+    
+    {
+        uint32_t offset = sizeof(game_header_t) + sizeof(game_header_ext_t) +
+                          directory_count * sizeof(game_section_t);
+        
+        for (uint32_t i = 0; i < count; i++) {
+            game_section_t* section = &table[i];
+            if (i == 0) {
+                strcpy(section->name, "code");
+                section->kind = GAME_SECTION_CODE;
+                section->size = header->code_size;
+                payloads[i] = code;
+            } else if (i == 1) {
+                strcpy(section->name, "data");
+                section->kind = GAME_SECTION_DATA;
+                section->size = header->data_size;
+                payloads[i] = data;
+            } else {
+                const game_package_section_t* source = &extra[i - 2];
+                if (strlen(source->name) >= GAME_SECTION_NAME ||
+                    source->kind < GAME_SECTION_ASSET || source->kind > GAME_SECTION_PREFETCH) {
+                    printf("Invalid section: %s\n", source->name);
+                    goto cleanup;
+                }
+                strcpy(section->name, source->name);
+                section->kind = source->kind;
+                section->size = source->size;
+                payloads[i] = source->data;
+            }
+            
+            section->compression = GAME_COMPRESSION_NONE;
+            section->stored_size = section->size;
+            
+            if (compression == GAME_COMPRESSION_LZ && section->size > 0) {
+                uint32_t bound = game_lz_compress_bound(section->size);
+                packed[i] = game_mem_alloc(gm, bound);
+                if (!packed[i]) {
+                    printf("Failed to allocate compression buffer\n");
+                    goto cleanup;
+                }
+                
+                uint32_t packed_size = game_lz_compress(payloads[i], section->size, packed[i], bound);
+                if (packed_size > 0 && packed_size < section->size) {
+                    section->compression = GAME_COMPRESSION_LZ;
+                    section->stored_size = packed_size;
+                    payloads[i] = packed[i];
+                }
+            }
+            
+            section->offset = offset;
+            offset += section->stored_size;
+        }
+    }
+    
+    ext.code_compression = table[0].compression;
+    ext.code_stored_size = table[0].stored_size;
+    ext.data_compression = table[1].compression;
+    ext.data_stored_size = table[1].stored_size;
+    
+    ext.checksum_type = GAME_CHECKSUM_CHUNKED;
+    out_header.checksum = game_compute_checksum(gm, code, header->code_size, data, header->data_size);
+    for (uint32_t i = 2; i < count; i++) {
+        table[i].checksum = game_compute_checksum(gm, extra[i - 2].data, extra[i - 2].size, NULL, 0);
+    }
+    
+    {
+        file_handle_t* file = game_fs_open(gm, path, 0x02); // Write mode
+        if (!file) {
+            printf("Failed to create package: %s\n", path);
+            goto cleanup;
+        }
+        
+        uint32_t table_size = directory_count * sizeof(game_section_t);
+        result = 0;
+        if (game_fs_write(gm, file, &out_header, sizeof(game_header_t)) != sizeof(game_header_t) ||
+            game_fs_write(gm, file, &ext, sizeof(game_header_ext_t)) != sizeof(game_header_ext_t) ||
+            game_fs_write(gm, file, table, table_size) != table_size) {
+            result = -1;
+        }
+        for (uint32_t i = 0; i < count && result == 0; i++) {
+            if (game_fs_write(gm, file, payloads[i], table[i].stored_size) != table[i].stored_size) {
+                result = -1;
+            }
+        }
+        if (result != 0) {
+            printf("Failed to write package: %s\n", path);
+        }
+        game_fs_close(gm, file);
+    }
+    
+cleanup:
+    if (packed) {
+        for (uint32_t i = 0; i < count; i++) {
+            if (packed[i]) {
+                game_mem_free(gm, packed[i]);
+            }
+        }
+        game_mem_free(gm, packed);
+    }
+    if (payloads) game_mem_free(gm, (void*)payloads);
+    if (table) game_mem_free(gm, table);
+    return result;
+}
+
+int game_reader_open(game_manager_t* gm, const char* path, game_package_reader_t* reader) {
+    memset(reader, 0, sizeof(game_package_reader_t));
+    reader->gm = gm;
+    reader->fd = -1;
+    if (strlen(path) >= MAX_PATH) {
+        return -1;
+    }
+    strcpy(reader->path, path);
+    
+    char host_path[MAX_PATH];
+    if (game_host_path(gm, path, host_path, sizeof(host_path)) == 0) {
+        reader->fd = open(host_path, O_RDONLY);
+        if (reader->fd >= 0) {
+            return 0;
+        }
+    }
+    
+    reader->file = game_fs_open(gm, path, 0x01); // Read mode
+    return reader->file ? 0 : -1;
+}
+
+// The file system only reads forwards, so seeking back reopens the file
+int game_reader_read(game_package_reader_t* reader, uint32_t offset, void* buffer, uint32_t size) {
+    if (reader->fd >= 0) {
+        uint8_t* bytes = (uint8_t*)buffer;
+        while (size > 0) {
+            ssize_t length = pread(reader->fd, bytes, size, offset);
+            if (length <= 0) {
+                return -1;
+            }
+            bytes += length;
+            offset += (uint32_t)length;
+            size -= (uint32_t)length;
+        }
+        return 0;
+    }
+    
+    if (offset < reader->position) {
+        game_fs_close(reader->gm, reader->file);
+        reader->file = game_fs_open(reader->gm, reader->path, 0x01);
+        reader->position = 0;
+        if (!reader->file) {
+            return -1;
+        }
+    }
+    
+    if (game_fs_skip(reader->gm, reader->file, offset - reader->position) != 0) {
+        return -1;
+    }
+    reader->position = offset;
+    
+    if (game_fs_read(reader->gm, reader->file, buffer, size) != size) {
+        return -1;
+    }
+    reader->position += size;
+    return 0;
+}
+
+int game_reader_read_section(game_package_reader_t* reader, game_section_t* section, void* buffer) {
+    if (section->compression == GAME_COMPRESSION_NONE) {
+        return game_reader_read(reader, section->offset, buffer, section->size);
+    }
+    
+    uint8_t* staging = (uint8_t*)game_mem_alloc(reader->gm, GAME_LOAD_CHUNK_SIZE);
+    if (!staging) {
+        return -1;
+    }
+    
+    game_lz_stream_t stream;
+    game_lz_stream_init(&stream, buffer, section->size);
+    
+    int result = 0;
+    for (uint32_t done = 0; done < section->stored_size && result == 0; ) {
+        uint32_t chunk = section->stored_size - done < GAME_LOAD_CHUNK_SIZE ?
+                         section->stored_size - done : GAME_LOAD_CHUNK_SIZE;
+        if (game_reader_read(reader, section->offset + done, staging, chunk) != 0 ||
+            game_lz_stream_feed(&stream, staging, chunk) != 0) {
+            result = -1;
+        }
+        done += chunk;
+    }
+    if (result == 0) {
+        result = game_lz_stream_finish(&stream);
+    }
+    
+    game_mem_free(reader->gm, staging);
+    return result;
+}
+
+void game_reader_close(game_package_reader_t* reader) {
+    if (reader->fd >= 0) {
+        close(reader->fd);
+    }
+    if (reader->file) {
+        game_fs_close(reader->gm, reader->file);
+    }
+    reader->fd = -1;
+    reader->file = NULL;
+}
+
+// Reads a package header and its extension. Host files are read with a
+// single pread covering the largest header layout this reader knows.
+int game_probe_read(game_manager_t* gm, const char* path, game_probe_record_t* record) {
+    memset(record, 0, sizeof(game_probe_record_t));
+    record->status = GAME_PROBE_UNREADABLE;
+    
+    char host_path[MAX_PATH];
+    int fd = -1;
+    if (game_host_path(gm, path, host_path, sizeof(host_path)) == 0) {
+        fd = open(host_path, O_RDONLY);
+    }
+    
+    if (fd >= 0) {
+        uint8_t buffer[sizeof(game_header_t) + sizeof(game_header_ext_t)];
+        ssize_t length = pread(fd, buffer, sizeof(buffer), 0);
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size <= (off_t)0xFFFFFFFFu) {
+            record->file_size = (uint32_t)st.st_size;
+        }
+        close(fd);
+        
+        if (length < (ssize_t)sizeof(game_header_t)) {
+            return -1;
+        }
+        memcpy(&record->header, buffer, sizeof(game_header_t));
+        record->status = GAME_PROBE_OK;
+        
+        if (record->header.version < GAME_VERSION_EXTENDED) {
+            record->ext.code_stored_size = record->header.code_size;
+            record->ext.data_stored_size = record->header.data_size;
+            return 0;
+        }
+        
+        uint32_t available = (uint32_t)length - sizeof(game_header_t);
+        uint32_t ext_size = 0;
+        if (available >= sizeof(uint32_t)) {
+            memcpy(&ext_size, buffer + sizeof(game_header_t), sizeof(uint32_t));
+        }
+        
+        uint32_t known = ext_size < sizeof(game_header_ext_t) ? ext_size : sizeof(game_header_ext_t);
+        if (ext_size < GAME_HEADER_EXT_MIN_SIZE || available < known) {
+            record->status = GAME_PROBE_INVALID_EXTENSION;
+            return -1;
+        }
+        memcpy(&record->ext, buffer + sizeof(game_header_t), known);
+        return 0;
+    }
+    
+    file_handle_t* file = game_fs_open(gm, path, 0x01); // Read mode
+    if (!file) {
+        return -1;
+    }
+    
+    int result = -1;
+    if (game_fs_read(gm, file, &record->header, sizeof(game_header_t)) == sizeof(game_header_t)) {
+        result = game_read_header_ext(gm, file, &record->header, &record->ext);
+        record->status = result == 0 ? GAME_PROBE_OK : GAME_PROBE_INVALID_EXTENSION;
+    }
+    game_fs_close(gm, file);
+    return result;
+}
+
+static void game_probe_batch_task(void* arg) {
+    game_probe_task_t* task = (game_probe_task_t*)arg;
+    for (uint32_t i = 0; i < task->count; i++) {
+        game_probe_read(task->gm, task->paths[i], &task->records[i]);
+    }
+    game_group_done(task->group);
+}
+
+// Probes many packages at once. Header reads are spread over the worker
+// pool in batches and validated together once they have all arrived, so a
+// directory is checked without a round trip per file. Fills one result per
+// path and returns how many are valid, or -1 if the probe could not start.
+int game_probe_headers(game_manager_t* gm, const char* const* paths, uint32_t count,
+                       game_probe_result_t* results) {
+    if (count == 0) {
+        return 0;
+    }
+    
+    uint32_t task_count = (count + GAME_PROBE_BATCH - 1) / GAME_PROBE_BATCH;
+    game_probe_record_t* records = (game_probe_record_t*)game_mem_alloc(gm, count * sizeof(game_probe_record_t));
+    game_probe_task_t* tasks = (game_probe_task_t*)game_mem_alloc(gm, task_count * sizeof(game_probe_task_t));
+    if (!records || !tasks) {
+        if (records) game_mem_free(gm, records);
+        if (tasks) game_mem_free(gm, tasks);
+        return -1;
+    }
+    
+    game_task_group_t group;
+    game_group_init(&group);
+    for (uint32_t i = 0; i < task_count; i++) {
+        uint32_t first = i * GAME_PROBE_BATCH;
+        game_probe_task_t* task = &tasks[i];
+        task->gm = gm;
+        task->paths = paths + first;
+        task->records = records + first;
+        task->count = count - first < GAME_PROBE_BATCH ? count - first : GAME_PROBE_BATCH;
+        task->group = &group;
+        
+        game_group_add(&group);
+        game_pool_submit(&gm->pool, game_probe_batch_task, task);
+    }
+    game_group_wait(&group);
+    game_group_destroy(&group);
+    
+    int valid = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        game_probe_record_t* record = &records[i];
+        game_probe_result_t* result = &results[i];
+        memset(result, 0, sizeof(game_probe_result_t));
+        
+        uint32_t status = record->status;
+        if (status != GAME_PROBE_UNREADABLE && validate_game_header(&record->header) != 0) {
+            status = GAME_PROBE_INVALID_HEADER;
+        } else if (status == GAME_PROBE_OK && validate_game_header_ext(&record->header, &record->ext) != 0) {
+            status = GAME_PROBE_INVALID_EXTENSION;
+        }
+        
+        result->status = status;
+        result->file_size = record->file_size;
+        if (status != GAME_PROBE_OK) {
+            continue;
+        }
+        
+        result->version = record->header.version;
+        result->type = record->header.type;
+        result->code_size = record->header.code_size;
+        result->data_size = record->header.data_size;
+        result->required_memory = record->header.required_memory;
+        result->save_data_size = record->header.save_data_size;
+        result->checksum = record->header.checksum;
+        strncpy(result->name, record->header.name, MAX_GAME_NAME - 1);
+        result->name[MAX_GAME_NAME - 1] = '\0';
+        strncpy(result->author, record->header.author, MAX_GAME_AUTHOR - 1);
+        result->author[MAX_GAME_AUTHOR - 1] = '\0';
+        valid++;
+    }
+    
+    game_mem_free(gm, tasks);
+    game_mem_free(gm, records);
+    return valid;
+}
+
+// Services native modules may import
+static const game_symbol_t game_symbols[] = {
+    { "game_save", (void*)game_save },
+    { "game_init_complete", (void*)game_init_complete },
+    { "game_asset_acquire", (void*)game_asset_acquire },
+    { "game_asset_release", (void*)game_asset_release },
+    { "game_find_by_name", (void*)game_find_by_name },
+    { "update_play_time", (void*)update_play_time },
+    { "calculate_checksum", (void*)calculate_checksum },
+    { "printf", (void*)printf },
+    { "memcpy", (void*)memcpy },
+    { "memset", (void*)memset },
+};
+
+void* game_resolve_symbol(const char* name) {
+    for (size_t i = 0; i < sizeof(game_symbols) / sizeof(game_symbols[0]); i++) {
+        if (strcmp(game_symbols[i].name, name) == 0) {
+            return game_symbols[i].address;
+        }
+    }
+    return NULL;
+}
+
+// Copies the code section into anonymous pages, applies its relocations
+// and imports once, then flips the pages to read+execute so code is never
+// writable and executable at the same time. Verified packages publish the
+// result as a prelinked module that later launches use without relinking.
+int game_link_code(game_manager_t* gm, game_instance_t* game) {
+    if (game->header.code_size == 0) {
+        return 0;
+    }
+    
+    if (game->header.entry_point >= game->header.code_size) {
+        printf("Entry point outside code section\n");
+        return -1;
+    }
+    
+    bool shareable = game->header_ext.checksum_type == GAME_CHECKSUM_CHUNKED;
+    game_module_t* module = shareable ? game_module_acquire(gm, game->package_path, game->header.checksum) : NULL;
+    
+    void* base = NULL;
+    size_t size = 0;
+    
+    if (!module) {
+        size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+        size = (game->header.code_size + page_size - 1) & ~(page_size - 1);
+        base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) {
+            return -1;
+        }
+        
+        memcpy(base, game->code_memory, game->header.code_size);
+        if (game_apply_relocations(gm, game, (uint8_t*)base) != 0 ||
+            mprotect(base, size, PROT_READ | PROT_EXEC) != 0) {
+            munmap(base, size);
+            return -1;
+        }
+    }
+    
+    // The loaded copy of the code is no longer needed
+    if (game->code_mapping) {
+        munmap(game->code_mapping, game->code_mapping_size);
+    } else {
+        game_mem_free(gm, game->code_memory);
+    }
+    game->code_mapping = NULL;
+    game->code_mapping_size = 0;
+    
+    if (!module && shareable) {
+        module = game_module_publish(gm, game->package_path, game->header.checksum, base, size);
+    }
+    
+    if (module) {
+        game->module = module;
+        game->code_memory = module->base;
+    } else {
+        // Not shareable, or no cache slot free: the instance owns the image
+        game->code_mapping = base;
+        game->code_mapping_size = size;
+        game->code_memory = base;
+    }
+    return 0;
+}
+
+int game_apply_relocations(game_manager_t* gm, game_instance_t* game, uint8_t* base) {
+    int reloc_index = game_find_section_kind(game, GAME_SECTION_RELOCS);
+    if (reloc_index < 0) {
+        return 0;  // Position-independent code
+    }
+    
+    game_section_t* reloc_section = &game->sections[reloc_index];
+    int import_index = game_find_section_kind(game, GAME_SECTION_IMPORTS);
+    game_section_t* import_section = import_index >= 0 ? &game->sections[import_index] : NULL;
+    
+    if (reloc_section->size % sizeof(game_reloc_t) != 0 ||
+        (import_section && import_section->size % sizeof(game_import_t) != 0)) {
+        printf("Malformed relocation tables\n");
+        return -1;
+    }
+    
+    uint32_t reloc_count = reloc_section->size / sizeof(game_reloc_t);
+    uint32_t import_count = import_section ? import_section->size / sizeof(game_import_t) : 0;
+    game_reloc_t* relocs = (game_reloc_t*)game_mem_alloc(gm, reloc_section->size ? reloc_section->size : 1);
+    game_import_t* imports = (game_import_t*)game_mem_alloc(gm, import_count ? import_section->size : 1);
+    void** addresses = (void**)game_mem_alloc(gm, import_count ? import_count * sizeof(void*) : 1);
+    int result = -1;
+    
+    game_package_reader_t reader;
+    if (!relocs || !imports || !addresses || game_reader_open(gm, game->package_path, &reader) != 0) {
+        goto cleanup;
+    }
+    
+    if (game_reader_read_section(&reader, reloc_section, relocs) != 0 ||
+        (import_section && game_reader_read_section(&reader, import_section, imports) != 0)) {
+        printf("Failed to read relocation tables\n");
+        game_reader_close(&reader);
+        goto cleanup;
+    }
+    game_reader_close(&reader);
+    
+    // Resolve every import against the service table up front
+    for (uint32_t i = 0; i < import_count; i++) {
+        imports[i].name[GAME_SYMBOL_NAME - 1] = '\0';
+        addresses[i] = game_resolve_symbol(imports[i].name);
+        if (!addresses[i]) {
+            printf("Unresolved import: %s\n", imports[i].name);
+            goto cleanup;
+        }
+    }
+    
+    for (uint32_t i = 0; i < reloc_count; i++) {
+        game_reloc_t* reloc = &relocs[i];
+        uint64_t value;
+        
+        if ((uint64_t)reloc->offset + sizeof(uint64_t) > game->header.code_size) {
+            printf("Relocation outside code section\n");
+            goto cleanup;
+        }
+        
+        if (reloc->type == GAME_RELOC_CODE) {
+            if (reloc->addend < 0 || (uint32_t)reloc->addend >= game->header.code_size) {
+                printf("Relocation target outside code section\n");
+                goto cleanup;
+            }
+            value = (uint64_t)(uintptr_t)base + (uint32_t)reloc->addend;
+        } else if (reloc->type == GAME_RELOC_IMPORT && reloc->symbol < import_count) {
+            value = (uint64_t)(uintptr_t)addresses[reloc->symbol] + (int64_t)reloc->addend;
+        } else {
+            printf("Invalid relocation %d\n", i);
+            goto cleanup;
+        }
+        
+        memcpy(base + reloc->offset, &value, sizeof(value));
+    }
+    result = 0;
+    
+cleanup:
+    if (relocs) game_mem_free(gm, relocs);
+    if (imports) game_mem_free(gm, imports);
+    if (addresses) game_mem_free(gm, addresses);
+    return result;
+}
+
+int game_find_section_kind(game_instance_t* game, uint32_t kind) {
+    for (uint32_t i = 0; i < game->section_count; i++) {
+        if (game->sections[i].kind == kind) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+game_module_t* game_module_acquire(game_manager_t* gm, const char* path, uint32_t checksum) {
+    game_module_t* found = NULL;
+    
+    pthread_mutex_lock(&gm->io_lock);
+    for (uint32_t i = 0; i < GAME_MODULE_CACHE_SLOTS; i++) {
+        game_module_t* module = &gm->modules[i];
+        if (module->ready && module->checksum == checksum && strcmp(module->path, path) == 0) {
+            module->refs++;
+            module->last_used = ++gm->module_clock;
+            found = module;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&gm->io_lock);
+    
+    return found;
+}
+
+// Registers a freshly linked image, reusing a free slot or the least
+// recently used idle one. Returns NULL if every slot is in use.
+game_module_t* game_module_publish(game_manager_t* gm, const char* path, uint32_t checksum, void* base, size_t size) {
+    game_module_t* slot = NULL;
+    
+    pthread_mutex_lock(&gm->io_lock);
+    for (uint32_t i = 0; i < GAME_MODULE_CACHE_SLOTS; i++) {
+        game_module_t* module = &gm->modules[i];
+        if (!module->ready) {
+            slot = module;
+            break;
+        }
+        if (module->refs == 0 && (!slot || module->last_used < slot->last_used)) {
+            slot = module;
+        }
+    }
+    
+    if (slot) {
+        if (slot->ready) {
+            munmap(slot->base, slot->size);
+        }
+        strcpy(slot->path, path);
+        slot->checksum = checksum;
+        slot->base = base;
+        slot->size = size;
+        slot->refs = 1;
+        slot->last_used = ++gm->module_clock;
+        slot->ready = true;
+    }
+    pthread_mutex_unlock(&gm->io_lock);
+    
+    return slot;
+}
+
+void game_module_release(game_manager_t* gm, game_module_t* module) {
+    pthread_mutex_lock(&gm->io_lock);
+    module->refs--;
+    pthread_mutex_unlock(&gm->io_lock);
+}
+
+void game_module_invalidate(game_manager_t* gm, const char* path) {
+    pthread_mutex_lock(&gm->io_lock);
+    for (uint32_t i = 0; i < GAME_MODULE_CACHE_SLOTS; i++) {
+        game_module_t* module = &gm->modules[i];
+        if (module->ready && module->refs == 0 && strcmp(module->path, path) == 0) {
+            munmap(module->base, module->size);
+            module->ready = false;
+        }
+    }
+    pthread_mutex_unlock(&gm->io_lock);
+}
+
+void game_module_clear(game_manager_t* gm) {
+    pthread_mutex_lock(&gm->io_lock);
+    for (uint32_t i = 0; i < GAME_MODULE_CACHE_SLOTS; i++) {
+        game_module_t* module = &gm->modules[i];
+        if (module->ready && module->refs == 0) {
+            munmap(module->base, module->size);
+            module->ready = false;
+        }
+    }
+    pthread_mutex_unlock(&gm->io_lock);
+}
+
+// Returns an asset of the current game, reading it from the package the
+// first time it is touched. Assets stay resident after their last release
+// until memory pressure evicts them.
+void* game_asset_acquire(game_manager_t* gm, const char* name, uint32_t* size) {
+    game_instance_t* game = gm->current_game;
+    if (!game) {
+        return NULL;
+    }
+    
+    int index = game_find_section(game, name, GAME_SECTION_ASSET);
+    if (index < 0) {
+        printf("Asset '%s' not found\n", name);
+        return NULL;
+    }
+    
+    game_section_t* section = &game->sections[index];
+    game_asset_t* asset = &game->assets[index];
+    
+    if (!asset->memory) {
+        if (game_reserve_memory(gm, game, section->size) != 0) {
+            printf("Not enough game memory for asset '%s'\n", name);
+            return NULL;
+        }
+        
+        asset->memory = game_mem_alloc(gm, section->size ? section->size : 1);
+        if (!asset->memory) {
+            printf("Failed to allocate asset '%s'\n", name);
+            return NULL;
+        }
+        
+        game_package_reader_t reader;
+        int result = game_reader_open(gm, game->package_path, &reader);
+        if (result == 0) {
+            result = game_reader_read_section(&reader, section, asset->memory);
+            game_reader_close(&reader);
+        }
+        if (result == 0 && game->header_ext.checksum_type == GAME_CHECKSUM_CHUNKED &&
+            game_compute_checksum(gm, asset->memory, section->size, NULL, 0) != section->checksum) {
+            printf("Checksum mismatch in asset '%s'\n", name);
+            result = -1;
+        }
+        if (result != 0) {
+            printf("Failed to read asset '%s'\n", name);
+            game_mem_free(gm, asset->memory);
+            asset->memory = NULL;
+            return NULL;
+        }
+        
+        game->resident_memory += section->size;
+        game_prefetch_record(game, (uint32_t)index, 0, section->stored_size);
+    }
+    
+    asset->ref_count++;
+    asset->last_used = ++game->asset_clock;
+    if (size) {
+        *size = section->size;
+    }
+    return asset->memory;
+}
+
+int game_asset_release(game_manager_t* gm, const char* name) {
+    game_instance_t* game = gm->current_game;
+    if (!game) {
+        return -1;
+    }
+    
+    int index = game_find_section(game, name, GAME_SECTION_ASSET);
+    if (index < 0 || game->assets[index].ref_count == 0) {
+        return -1;
+    }
+    
+    game->assets[index].ref_count--;
+    return 0;
+}
+
+int game_find_section(game_instance_t* game, const char* name, uint32_t kind) {
+    for (uint32_t i = 0; i < game->section_count; i++) {
+        if (game->sections[i].kind == kind && strcmp(game->sections[i].name, name) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+// Makes room for size more resident bytes within max_game_memory by
+// evicting the least recently used released assets
+int game_reserve_memory(game_manager_t* gm, game_instance_t* game, uint32_t size) {
+    while (game->resident_memory + size > gm->max_game_memory) {
+        int victim = -1;
+        for (uint32_t i = 0; i < game->section_count; i++) {
+            game_asset_t* asset = &game->assets[i];
+            if (asset->memory && asset->ref_count == 0 &&
+                (victim < 0 || asset->last_used < game->assets[victim].last_used)) {
+                victim = (int)i;
+            }
+        }
+        
+        if (victim < 0) {
+            return -1;
+        }
+        
+        game_mem_free(gm, game->assets[victim].memory);
+        game->assets[victim].memory = NULL;
+        game->resident_memory -= game->sections[victim].size;
+    }
+    
+    return 0;
+}
+
+int game_fs_skip(game_manager_t* gm, file_handle_t* file, uint32_t size) {
+    uint8_t scratch[256];
+    while (size > 0) {
+        uint32_t chunk = size < sizeof(scratch) ? size : (uint32_t)sizeof(scratch);
+        if (game_fs_read(gm, file, scratch, chunk) != chunk) {
+            return -1;
+        }
+        size -= chunk;
+    }
+    return 0;
+}
+
+file_handle_t* game_fs_open(game_manager_t* gm, const char* path, uint32_t mode) {
+    pthread_mutex_lock(&gm->io_lock);
+    file_handle_t* file = fs_open(gm->fs, path, mode);
+    pthread_mutex_unlock(&gm->io_lock);
+    return file;
+}
+
+uint32_t game_fs_read(game_manager_t* gm, file_handle_t* file, void* buffer, uint32_t size) {
+    pthread_mutex_lock(&gm->io_lock);
+    uint32_t bytes = fs_read(gm->fs, file, buffer, size);
+    pthread_mutex_unlock(&gm->io_lock);
+    return bytes;
+}
+
+uint32_t game_fs_write(game_manager_t* gm, file_handle_t* file, const void* buffer, uint32_t size) {
+    pthread_mutex_lock(&gm->io_lock);
+    uint32_t bytes = fs_write(gm->fs, file, buffer, size);
+    pthread_mutex_unlock(&gm->io_lock);
+    return bytes;
+}
+
+void game_fs_close(game_manager_t* gm, file_handle_t* file) {
+    pthread_mutex_lock(&gm->io_lock);
+    fs_close(file);
+    pthread_mutex_unlock(&gm->io_lock);
+}
+
+// Cached images are the first thing to go when memory runs short
+void* game_mem_alloc(game_manager_t* gm, uint32_t size) {
+    pthread_mutex_lock(&gm->io_lock);
+    void* ptr = memory_alloc(gm->mm, size, MEM_TYPE_GAME);
+    while (!ptr && game_cache_evict_locked(gm)) {
+        ptr = memory_alloc(gm->mm, size, MEM_TYPE_GAME);
+    }
+    pthread_mutex_unlock(&gm->io_lock);
+    return ptr;
+}
+
+void game_mem_free(game_manager_t* gm, void* ptr) {
+    pthread_mutex_lock(&gm->io_lock);
+    memory_free(gm->mm, ptr);
+    pthread_mutex_unlock(&gm->io_lock);
+}
+
+// Restores a copy of a cached image into freshly allocated memory. The
+// entry is pinned while it is copied so pressure can't evict it meanwhile.
+// Only an image of the same package, by checksum and file size, is
+// restored, and only if it still fits the game memory limit; anything else
+// is a miss and loads from disk.
+int game_cache_restore(game_manager_t* gm, game_registry_entry_t* entry, game_instance_t* game) {
+    game_image_cache_t* cache = &gm->image_cache;
+    game_cached_image_t* image = NULL;
+    
+    pthread_mutex_lock(&gm->io_lock);
+    for (uint32_t i = 0; i < GAME_IMAGE_CACHE_SLOTS; i++) {
+        game_cached_image_t* candidate = &cache->entries[i];
+        if (candidate->ready && strcmp(candidate->path, entry->path) == 0 &&
+            entry->checksum != 0 && entry->checksum == candidate->checksum &&
+            entry->size == candidate->package_size &&
+            candidate->header.required_memory <= gm->max_game_memory) {
+            image = candidate;
+            image->pins++;
+            image->last_used = ++cache->clock;
+            break;
+        }
+    }
+    if (image) {
+        cache->hits++;
+    } else {
+        cache->misses++;
+    }
+    pthread_mutex_unlock(&gm->io_lock);
+    
+    if (!image) {
+        return -1;
+    }
+    
+    int result = 0;
+    game->header = image->header;
+    game->header_ext = image->header_ext;
+    game->code_offset = image->code_offset;
+    game->data_offset = image->data_offset;
+    game->code_memory = game_mem_alloc(gm, image->header.code_size);
+    game->data_memory = game_mem_alloc(gm, image->header.data_size);
+    if (image->section_count > 0) {
+        game->sections = (game_section_t*)game_mem_alloc(gm, image->section_count * sizeof(game_section_t));
+        game->assets = (game_asset_t*)game_mem_alloc(gm, image->section_count * sizeof(game_asset_t));
+        game->section_count = image->section_count;
+    }
+    
+    if (!game->code_memory || !game->data_memory ||
+        (image->section_count > 0 && (!game->sections || !game->assets))) {
+        result = -1;
+    } else {
+        memcpy(game->code_memory, image->code, image->header.code_size);
+        memcpy(game->data_memory, image->data, image->header.data_size);
+        if (image->section_count > 0) {
+            memcpy(game->sections, image->sections, image->section_count * sizeof(game_section_t));
+            memset(game->assets, 0, image->section_count * sizeof(game_asset_t));
+        }
+    }
+    
+    pthread_mutex_lock(&gm->io_lock);
+    image->pins--;
+    pthread_mutex_unlock(&gm->io_lock);
+    
+    if (result != 0) {
+        // Leave the half-built instance for the caller to fall back on disk
+        game_release_memory(gm, game);
+        memset(&game->header, 0, sizeof(game_header_t));
+    }
+    return result;
+}
+
+// Copies a freshly loaded image into the cache, evicting least recently
+// used images to stay within the budget. Packages without a checksum are
+// not cached, as a restore could not tell them from a replacement.
+void game_cache_store(game_manager_t* gm, game_registry_entry_t* entry, game_instance_t* game) {
+    game_image_cache_t* cache = &gm->image_cache;
+    uint32_t section_bytes = game->section_count * sizeof(game_section_t);
+    uint32_t size = game->header.code_size + game->header.data_size + section_bytes;
+    
+    if (size > cache->budget || game->header.checksum == 0) {
+        return;
+    }
+    
+    void* code = game_mem_alloc(gm, game->header.code_size);
+    void* data = game_mem_alloc(gm, game->header.data_size);
+    game_section_t* sections = section_bytes ? (game_section_t*)game_mem_alloc(gm, section_bytes) : NULL;
+    
+    if (!code || !data || (section_bytes && !sections)) {
+        if (code) game_mem_free(gm, code);
+        if (data) game_mem_free(gm, data);
+        if (sections) game_mem_free(gm, sections);
+        return;
+    }
+    
+    memcpy(code, game->code_memory, game->header.code_size);
+    memcpy(data, game->data_memory, game->header.data_size);
+    if (section_bytes) {
+        memcpy(sections, game->sections, section_bytes);
+    }
+    
+    pthread_mutex_lock(&gm->io_lock);
+    
+    // Replace any older copy of the same package
+    game_cached_image_t* slot = NULL;
+    for (uint32_t i = 0; i < GAME_IMAGE_CACHE_SLOTS; i++) {
+        game_cached_image_t* image = &cache->entries[i];
+        if (image->ready && image->pins == 0 && strcmp(image->path, entry->path) == 0) {
+            image->last_used = 0;
+            game_cache_evict_locked(gm);
+        }
+    }
+    
+    while (cache->used + size > cache->budget && game_cache_evict_locked(gm)) {
+    }
+    for (uint32_t i = 0; i < GAME_IMAGE_CACHE_SLOTS && !slot; i++) {
+        if (!cache->entries[i].ready) {
+            slot = &cache->entries[i];
+        }
+    }
+    if (!slot && game_cache_evict_locked(gm)) {
+        for (uint32_t i = 0; i < GAME_IMAGE_CACHE_SLOTS && !slot; i++) {
+            if (!cache->entries[i].ready) {
+                slot = &cache->entries[i];
+            }
+        }
+    }
+    
+    if (!slot || cache->used + size > cache->budget) {
+        memory_free(gm->mm, code);
+        memory_free(gm->mm, data);
+        if (sections) memory_free(gm->mm, sections);
+        pthread_mutex_unlock(&gm->io_lock);
+        return;
+    }
+    
+    memset(slot, 0, sizeof(game_cached_image_t));
+    strcpy(slot->path, entry->path);
+    slot->checksum = game->header.checksum;
+    slot->package_size = entry->size;
+    slot->header = game->header;
+    slot->header_ext = game->header_ext;
+    slot->code_offset = game->code_offset;
+    slot->data_offset = game->data_offset;
+    slot->code = code;
+    slot->data = data;
+    slot->sections = sections;
+    slot->section_count = game->section_count;
+    slot->size = size;
+    slot->last_used = ++cache->clock;
+    slot->ready = true;
+    cache->used += size;
+    
+    pthread_mutex_unlock(&gm->io_lock);
+}
+
+// Drops cached copies of a package whose contents have changed, including
+// its prelinked code
+void game_cache_invalidate(game_manager_t* gm, const char* path) {
+    game_module_invalidate(gm, path);
+
+    pthread_mutex_lock(&gm->io_lock);
+    for (uint32_t i = 0; i < GAME_IMAGE_CACHE_SLOTS; i++) {
+        game_cached_image_t* image = &gm->image_cache.entries[i];
+        if (image->ready && image->pins == 0 && strcmp(image->path, path) == 0) {
+            image->last_used = 0;
+            game_cache_evict_locked(gm);
+        }
+    }
+    pthread_mutex_unlock(&gm->io_lock);
+}
+
+void game_cache_set_budget(game_manager_t* gm, uint32_t budget) {
+    pthread_mutex_lock(&gm->io_lock);
+    gm->image_cache.budget = budget;
+    while (gm->image_cache.used > budget && game_cache_evict_locked(gm)) {
+    }
+    pthread_mutex_unlock(&gm->io_lock);
+}
+
+// Frees the least recently used unpinned image. Called with io_lock held;
+// returns false when there is nothing left to evict.
+bool game_cache_evict_locked(game_manager_t* gm) {
+    game_image_cache_t* cache = &gm->image_cache;
+    game_cached_image_t* victim = NULL;
+    
+    for (uint32_t i = 0; i < GAME_IMAGE_CACHE_SLOTS; i++) {
+        game_cached_image_t* image = &cache->entries[i];
+        if (image->ready && image->pins == 0 && (!victim || image->last_used < victim->last_used)) {
+            victim = image;
+        }
+    }
+    
+    if (!victim) {
+        return false;
+    }
+    
+    memory_free(gm->mm, victim->code);
+    memory_free(gm->mm, victim->data);
+    if (victim->sections) {
+        memory_free(gm->mm, victim->sections);
+    }
+    cache->used -= victim->size;
+    victim->ready = false;
+    return true;
+}
+
+void game_cache_clear(game_manager_t* gm) {
+    pthread_mutex_lock(&gm->io_lock);
+    while (game_cache_evict_locked(gm)) {
+    }
+    pthread_mutex_unlock(&gm->io_lock);
+}
+
+// Sets the host directory backing the file system and attaches the
+// registry catalog kept there
+int game_set_host_root(game_manager_t* gm, const char* host_root) {
+    if (host_root && strlen(host_root) >= MAX_PATH) {
+        return -1;
+    }
+    
+    // Watches belong to the old root
+    game_watch_stop(gm);
+    
+    game_registry_write_begin(gm);
+    if (gm->registry.catalog && game_catalog_detach(gm) != 0) {
+        game_registry_write_end(gm);
+        return -1;
+    }
+    
+    if (!host_root) {
+        gm->host_root[0] = '\0';
+        return game_registry_write_end(gm);
+    }
+    
+    // Store without a trailing slash so file system paths can be appended
+    size_t length = strlen(host_root);
+    while (length > 1 && host_root[length - 1] == '/') {
+        length--;
+    }
+    memcpy(gm->host_root, host_root, length);
+    gm->host_root[length] = '\0';
+    
+    if (game_catalog_attach(gm) != 0) {
+        printf("Registry catalog unavailable, keeping registry in memory\n");
+    }
+    int result = game_registry_write_end(gm);
+    
+    game_install_recover(gm);
+    return result;
+}
+
+int game_host_path(game_manager_t* gm, const char* path, char* host_path, size_t size) {
+    if (gm->host_root[0] == '\0' || path[0] != '/') {
+        return -1;
+    }
+    
+    int length = snprintf(host_path, size, "%s%s", gm->host_root, path);
+    if (length < 0 || (size_t)length >= size) {
+        return -1;
+    }
+    return 0;
+}
+
+int game_run(game_manager_t* gm) {
+    if (!gm->current_game) {
+        printf("No game loaded\n");
+        return -1;
+    }
+    
+    game_instance_t* game = gm->current_game;
+    
+    if (game->state != GAME_STATE_LOADING && game->state != GAME_STATE_PAUSED) {
+        printf("Game is not in a runnable state\n");
+        return -1;
+    }
+    
+    game->state = GAME_STATE_RUNNING;
+    printf("Running game: %s\n", game->header.name);
+    
+    // Game main loop
+    int result = 0;
+    
+    // Handle built-in games
+    if (strcmp(game->header.name, "Pong") == 0) {
+        result = demo_game_pong(gm, game->data_memory);
+    } else if (strcmp(game->header.name, "Tetris") == 0) {
+        result = demo_game_tetris(gm, game->data_memory);
+    } else if (strcmp(game->header.name, "Snake") == 0) {
+        result = demo_game_snake(gm, game->data_memory);
+    } else {
+        // Execute loaded game code from its linked, executable image,
+        // resuming past initialization when a snapshot was restored
+        uint32_t entry = game->resume_point ? game->resume_point : game->header.entry_point;
+        if (game->code_memory && entry) {
+            game_main_func main_func = (game_main_func)((char*)game->code_memory + entry);
+            result = main_func(gm, game->data_memory);
+        } else {
+            printf("No executable code found\n");
+            result = -1;
+        }
+    }
+    
+    // Update play time
+    update_play_time(gm);
+    
+    if (result == 0) {
+        printf("Game completed successfully\n");
+    } else {
+        printf("Game ended with error code: %d\n", result);
+        game->state = GAME_STATE_ERROR;
+    }
+    
+    return result;
+}
+
+int game_stop(game_manager_t* gm) {
+    if (!gm->current_game) {
+        return 0;
+    }
+    
+    game_instance_t* game = gm->current_game;
+    
+    printf("Stopping game: %s\n", game->header.name);
+    
+    // Update statistics
+    update_play_time(gm);
+    gm->total_games_played++;
+    gm->total_play_time += game->play_time;
+    
+    if (game->prefetch_log && game_prefetch_save(gm, game) == 0) {
+        printf("Recorded %d prefetch ranges\n", game->prefetch_count);
+    }
+    
+    // Free game memory, unmapping anything mapped from the package image.
+    // Private data pages are simply discarded, never written back.
+    game_release_memory(gm, game);
+    
+    // Free game instance
+    game_mem_free(gm, game);
+    gm->current_game = NULL;
+    
+    printf("Game stopped and memory freed\n");
+    return 0;
+}
+
+// Called by a game once its initialization is done. Persists data_memory
+// and the instance state so later launches can resume at resume_point, a
+// game_main_func in the code section, without initializing again.
+int game_init_complete(game_manager_t* gm, uint32_t resume_point) {
+    game_instance_t* game = gm->current_game;
+    if (!game || game->header.code_size == 0 ||
+        resume_point == 0 || resume_point >= game->header.code_size) {
+        return -1;
+    }
+    
+    game_snapshot_header_t snapshot;
+    memset(&snapshot, 0, sizeof(game_snapshot_header_t));
+    snapshot.signature = SNAPSHOT_SIGNATURE;
+    snapshot.version = GAME_SNAPSHOT_VERSION;
+    snapshot.game_checksum = game->header.checksum;
+    snapshot.data_size = game->header.data_size;
+    snapshot.data_checksum = game_compute_checksum(gm, NULL, 0, game->data_memory, game->header.data_size);
+    snapshot.resume_point = resume_point;
+    snapshot.current_level = game->current_level;
+    snapshot.current_score = game->current_score;
+    
+    char path[MAX_PATH];
+    game_snapshot_path(game, path, sizeof(path));
+    
+    file_handle_t* file = game_fs_open(gm, path, 0x02); // Write mode
+    if (!file) {
+        printf("Failed to create snapshot: %s\n", path);
+        return -1;
+    }
+    
+    int result = 0;
+    static const uint8_t padding[GAME_SNAPSHOT_DATA_OFFSET - sizeof(game_snapshot_header_t)] = { 0 };
+    if (game_fs_write(gm, file, &snapshot, sizeof(snapshot)) != sizeof(snapshot) ||
+        game_fs_write(gm, file, padding, sizeof(padding)) != sizeof(padding) ||
+        game_fs_write(gm, file, game->data_memory, snapshot.data_size) != snapshot.data_size) {
+        printf("Failed to write snapshot: %s\n", path);
+        result = -1;
+    }
+    game_fs_close(gm, file);
+    
+    if (result == 0) {
+        printf("Saved post-init snapshot for %s\n", game->header.name);
+    }
+    return result;
+}
+
+// Replaces a freshly loaded data image with the game's post-init snapshot.
+// With a host file the snapshot is mapped privately in one go; otherwise
+// it is read with a single fs_read. Snapshots from another build of the
+// package, or that fail their checksum, are ignored.
+int game_restore_snapshot(game_manager_t* gm, game_instance_t* game) {
+    if (game->header.code_size == 0 || game->header.data_size == 0) {
+        return -1;
+    }
+    
+    char path[MAX_PATH];
+    char host_path[MAX_PATH];
+    game_snapshot_path(game, path, sizeof(path));
+    
+    game_snapshot_header_t snapshot;
+    uint32_t data_size = game->header.data_size;
+    void* mapping = NULL;
+    void* buffer = NULL;
+    
+    int fd = -1;
+    if (game_host_path(gm, path, host_path, sizeof(host_path)) == 0) {
+        fd = open(host_path, O_RDONLY);
+    }
+    
+    if (fd >= 0) {
+        struct stat st;
+        if (pread(fd, &snapshot, sizeof(snapshot), 0) == (ssize_t)sizeof(snapshot) &&
+            snapshot.signature == SNAPSHOT_SIGNATURE && snapshot.data_size == data_size &&
+            fstat(fd, &st) == 0 && st.st_size >= GAME_SNAPSHOT_DATA_OFFSET + (off_t)data_size) {
+            mapping = mmap(NULL, data_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, GAME_SNAPSHOT_DATA_OFFSET);
+            if (mapping == MAP_FAILED) {
+                mapping = NULL;
+            }
+        }
+        close(fd);
+    } else {
+        file_handle_t* file = game_fs_open(gm, path, 0x01); // Read mode
+        if (!file) {
+            return -1;
+        }
+        if (game_fs_read(gm, file, &snapshot, sizeof(snapshot)) == sizeof(snapshot) &&
+            snapshot.signature == SNAPSHOT_SIGNATURE && snapshot.data_size == data_size &&
+            snapshot.game_checksum == game->header.checksum &&
+            game_fs_skip(gm, file, GAME_SNAPSHOT_DATA_OFFSET - sizeof(snapshot)) == 0) {
+            buffer = game_mem_alloc(gm, data_size);
+            if (buffer && game_fs_read(gm, file, buffer, data_size) != data_size) {
+                game_mem_free(gm, buffer);
+                buffer = NULL;
+            }
+        }
+        game_fs_close(gm, file);
+    }
+    
+    void* restored = mapping ? mapping : buffer;
+    if (!restored) {
+        return -1;
+    }
+    
+    if (snapshot.version != GAME_SNAPSHOT_VERSION || snapshot.game_checksum != game->header.checksum ||
+        snapshot.resume_point == 0 || snapshot.resume_point >= game->header.code_size ||
+        game_compute_checksum(gm, NULL, 0, restored, data_size) != snapshot.data_checksum) {
+        printf("Ignoring stale snapshot: %s\n", path);
+        if (mapping) {
+            munmap(mapping, data_size);
+        } else {
+            game_mem_free(gm, buffer);
+        }
+        return -1;
+    }
+    
+    if (game->data_mapping) {
+        munmap(game->data_mapping, game->data_mapping_size);
+    } else {
+        game_mem_free(gm, game->data_memory);
+    }
+    game->data_mapping = mapping;
+    game->data_mapping_size = mapping ? data_size : 0;
+    game->data_memory = restored;
+    
+    game->resume_point = snapshot.resume_point;
+    game->current_level = snapshot.current_level;
+    game->current_score = snapshot.current_score;
+    return 0;
+}
+
+void game_snapshot_path(game_instance_t* game, char* path, size_t size) {
+    snprintf(path, size, "/games/%s.snap", game->header.name);
+}
+
+static void game_prefetch_task(void* arg) {
+    game_prefetch_task_t* task = (game_prefetch_task_t*)arg;
+    for (uint32_t i = 0; i < task->range_count; i++) {
+        posix_fadvise(task->fd, task->ranges[i].offset, task->ranges[i].size, POSIX_FADV_WILLNEED);
+    }
+    close(task->fd);
+    game_mem_free(task->gm, task);
+}
+
+// Issues read-ahead for the game's prefetch manifest, taken from its
+// package or else from a recorded manifest, in the order the ranges were
+// read. Read-ahead needs the host file, so it is skipped without one.
+// Also starts recording when the game was loaded with
+// GAME_LOAD_RECORD_PREFETCH.
+int game_prefetch_start(game_manager_t* gm, game_instance_t* game) {
+    if (game->section_count == 0) {
+        return -1;
+    }
+    
+    if (game->load_flags & GAME_LOAD_RECORD_PREFETCH) {
+        game->prefetch_log = (game_prefetch_range_t*)game_mem_alloc(gm,
+            GAME_PREFETCH_MAX_RANGES * sizeof(game_prefetch_range_t));
+        game->prefetch_count = 0;
+        
+        // Mapped code and data are paged in as the game runs
+        if (game->prefetch_log && (game->load_flags & GAME_LOAD_MAPPED)) {
+            int code = game_find_section_kind(game, GAME_SECTION_CODE);
+            int data = game_find_section_kind(game, GAME_SECTION_DATA);
+            game_prefetch_record(game, (uint32_t)code, 0, game->sections[code].stored_size);
+            game_prefetch_record(game, (uint32_t)data, 0, game->sections[data].stored_size);
+        }
+    }
+    
+    char host_path[MAX_PATH];
+    if (game_host_path(gm, game->package_path, host_path, sizeof(host_path)) != 0) {
+        return -1;
+    }
+    
+    game_prefetch_task_t* task = (game_prefetch_task_t*)game_mem_alloc(gm, sizeof(game_prefetch_task_t) +
+        GAME_PREFETCH_MAX_RANGES * sizeof(game_prefetch_range_t));
+    if (!task) {
+        return -1;
+    }
+    task->gm = gm;
+    task->ranges = (game_prefetch_range_t*)(task + 1);
+    task->range_count = 0;
+    
+    int index = game_find_section_kind(game, GAME_SECTION_PREFETCH);
+    if (index >= 0) {
+        game_section_t* section = &game->sections[index];
+        game_package_reader_t reader;
+        if (section->size <= GAME_PREFETCH_MAX_RANGES * sizeof(game_prefetch_range_t) &&
+            game_reader_open(gm, game->package_path, &reader) == 0) {
+            if (game_reader_read_section(&reader, section, task->ranges) == 0) {
+                task->range_count = section->size / sizeof(game_prefetch_range_t);
+            }
+            game_reader_close(&reader);
+        }
+    } else {
+        char path[MAX_PATH];
+        game_prefetch_path(game, path, sizeof(path));
+        file_handle_t* file = game_fs_open(gm, path, 0x01); // Read mode
+        if (file) {
+            game_prefetch_header_t header;
+            if (game_fs_read(gm, file, &header, sizeof(header)) == sizeof(header) &&
+                header.signature == PREFETCH_SIGNATURE && header.game_checksum == game->header.checksum &&
+                header.range_count <= GAME_PREFETCH_MAX_RANGES) {
+                uint32_t size = header.range_count * sizeof(game_prefetch_range_t);
+                if (game_fs_read(gm, file, task->ranges, size) == size) {
+                    task->range_count = header.range_count;
+                }
+            }
+            game_fs_close(gm, file);
+        }
+    }
+    
+    // Hints are advisory, so ranges outside their section are dropped
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < task->range_count; i++) {
+        game_prefetch_range_t range = task->ranges[i];
+        if (range.section >= game->section_count) {
+            continue;
+        }
+        game_section_t* section = &game->sections[range.section];
+        if (range.offset >= section->stored_size) {
+            continue;
+        }
+        if (range.size > section->stored_size - range.offset) {
+            range.size = section->stored_size - range.offset;
+        }
+        task->ranges[count].section = range.section;
+        task->ranges[count].offset = section->offset + range.offset;
+        task->ranges[count].size = range.size;
+        count++;
+    }
+    task->range_count = count;
+    
+    task->fd = count > 0 ? open(host_path, O_RDONLY) : -1;
+    if (task->fd < 0) {
+        game_mem_free(gm, task);
+        return -1;
+    }
+    
+    game_pool_submit(&gm->pool, game_prefetch_task, task);
+    return 0;
+}
+
+// Appends a package read to the recording, keeping only the first read of
+// each range so the manifest follows first-use order
+void game_prefetch_record(game_instance_t* game, uint32_t section, uint32_t offset, uint32_t size) {
+    if (!game->prefetch_log || game->prefetch_count == GAME_PREFETCH_MAX_RANGES || size == 0) {
+        return;
+    }
+    
+    for (uint32_t i = 0; i < game->prefetch_count; i++) {
+        game_prefetch_range_t* range = &game->prefetch_log[i];
+        if (range->section == section && range->offset == offset && range->size >= size) {
+            return;
+        }
+    }
+    
+    game_prefetch_range_t* range = &game->prefetch_log[game->prefetch_count++];
+    range->section = section;
+    range->offset = offset;
+    range->size = size;
+}
+
+// Writes the recorded ranges as the game's prefetch manifest. The same
+// ranges can be packaged as a GAME_SECTION_PREFETCH section.
+int game_prefetch_save(game_manager_t* gm, game_instance_t* game) {
+    if (!game->prefetch_log || game->prefetch_count == 0) {
+        return -1;
+    }
+    
+    game_prefetch_header_t header;
+    header.signature = PREFETCH_SIGNATURE;
+    header.game_checksum = game->header.checksum;
+    header.range_count = game->prefetch_count;
+    
+    char path[MAX_PATH];
+    game_prefetch_path(game, path, sizeof(path));
+    file_handle_t* file = game_fs_open(gm, path, 0x02); // Write mode
+    if (!file) {
+        return -1;
+    }
+    
+    uint32_t size = game->prefetch_count * sizeof(game_prefetch_range_t);
+    int result = 0;
+    if (game_fs_write(gm, file, &header, sizeof(header)) != sizeof(header) ||
+        game_fs_write(gm, file, game->prefetch_log, size) != size) {
+        result = -1;
+    }
+    game_fs_close(gm, file);
+    return result;
+}
+
+void game_prefetch_path(game_instance_t* game, char* path, size_t size) {
+    snprintf(path, size, "/games/%s.prefetch", game->header.name);
+}
+
+static int game_sync_directory(game_manager_t* gm, const char* path) {
+    char host_path[MAX_PATH];
+    if (game_host_path(gm, path, host_path, sizeof(host_path)) != 0) {
+        return -1;
+    }
+    
+    int fd = open(host_path, O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        return -1;
+    }
+    int result = fsync(fd);
+    close(fd);
+    return result;
+}
+
+// Bytes at the start of data_memory that saves carry
+static uint32_t game_save_region(game_instance_t* game) {
+    uint32_t size = game->header.save_data_size;
+    return size < game->header.data_size ? size : game->header.data_size;
+}
+
+// Sets up block tracking for a game's save region
+static int game_save_track(game_manager_t* gm, game_instance_t* game) {
+    if (game->save_shadow) {
+        return 0;
+    }
+    
+    uint32_t region = game_save_region(game);
+    uint32_t blocks = (region + GAME_SAVE_BLOCK_SIZE - 1) / GAME_SAVE_BLOCK_SIZE;
+    game->save_dirty = (uint8_t*)game_mem_alloc(gm, blocks / 8 + 1);
+    game->save_shadow = (uint8_t*)game_mem_alloc(gm, region + 1);
+    if (!game->save_dirty || !game->save_shadow) {
+        if (game->save_dirty) game_mem_free(gm, game->save_dirty);
+        if (game->save_shadow) game_mem_free(gm, game->save_shadow);
+        game->save_dirty = NULL;
+        game->save_shadow = NULL;
+        return -1;
+    }
+    memset(game->save_dirty, 0, blocks / 8 + 1);
+    game->save_slot = 0;
+    return 0;
+}
+
+// Marks that a game changed size bytes of data_memory at offset. A game
+// that marks its writes has to mark all of them: its saves then trust
+// the marks instead of comparing the save region with the last save.
+void game_save_mark(game_manager_t* gm, uint32_t offset, uint32_t size) {
+    game_instance_t* game = gm->current_game;
+    if (!game || size == 0 || offset >= game_save_region(game) || game_save_track(gm, game) != 0) {
+        return;
+    }
+    
+    uint32_t region = game_save_region(game);
+    uint32_t last = (size > region - offset ? region - 1 : offset + size - 1) / GAME_SAVE_BLOCK_SIZE;
+    for (uint32_t block = offset / GAME_SAVE_BLOCK_SIZE; block <= last; block++) {
+        game->save_dirty[block / 8] |= (uint8_t)(1u << (block % 8));
+    }
+    game->save_marked = true;
+}
+
+// Chooses how full saves of the current game to a slot store their data.
+// Compression happens on the saver thread, and data that doesn't shrink
+// is stored raw.
+int game_save_set_compression(game_manager_t* gm, int slot, uint32_t compression) {
+    if (!gm->current_game || slot < 0 || slot >= MAX_SAVE_SLOTS) {
+        return -1;
+    }
+    if (compression != GAME_COMPRESSION_NONE && compression != GAME_COMPRESSION_LZ) {
+        printf("Unknown save compression: %d\n", compression);
+        return -1;
+    }
+    
+    gm->current_game->save_compression[slot] = (uint8_t)compression;
+    return 0;
+}
+
+// Fills in the header that goes ahead of a job's data in a full save,
+// apart from how the data is stored
+static void game_save_full_header(game_save_job_t* job, save_game_t* header) {
+    memset(header, 0, sizeof(save_game_t));
+    header->signature = SAVE_SIGNATURE;
+    header->version = GAME_SAVE_VERSION;
+    header->game_checksum = job->game_checksum;
+    header->save_time = job->save_time;
+    header->play_time = job->play_time;
+    header->level = job->level;
+    header->score = job->score;
+    header->data_size = job->size;
+    header->data_checksum = calculate_checksum(job->data, job->size);
+}
+
+// Builds the delta record of a job's dirty blocks
+static uint8_t* game_save_delta_record(game_manager_t* gm, game_save_job_t* job, uint32_t sequence,
+                                       uint32_t* size) {
+    uint32_t blocks = (job->size + GAME_SAVE_BLOCK_SIZE - 1) / GAME_SAVE_BLOCK_SIZE;
+    uint32_t block_count = 0;
+    for (uint32_t block = 0; block < blocks; block++) {
+        block_count += (job->dirty[block / 8] >> (block % 8)) & 1;
+    }
+    
+    uint8_t* record = (uint8_t*)game_mem_alloc(gm, sizeof(save_delta_header_t) +
+                                                   block_count * (sizeof(uint32_t) + GAME_SAVE_BLOCK_SIZE));
+    if (!record) {
+        return NULL;
+    }
+    
+    uint8_t* payload = record + sizeof(save_delta_header_t);
+    uint32_t payload_size = 0;
+    for (uint32_t block = 0; block < blocks; block++) {
+        if (!((job->dirty[block / 8] >> (block % 8)) & 1)) {
+            continue;
+        }
+        uint32_t offset = block * GAME_SAVE_BLOCK_SIZE;
+        uint32_t length = job->size - offset < GAME_SAVE_BLOCK_SIZE ? job->size - offset : GAME_SAVE_BLOCK_SIZE;
+        memcpy(payload + payload_size, &block, sizeof(uint32_t));
+        memcpy(payload + payload_size + sizeof(uint32_t), job->data + offset, length);
+        payload_size += sizeof(uint32_t) + length;
+    }
+    
+    save_delta_header_t header;
+    memset(&header, 0, sizeof(save_delta_header_t));
+    header.signature = SAVE_DELTA_SIGNATURE;
+    header.sequence = sequence;
+    header.save_time = job->save_time;
+    header.play_time = job->play_time;
+    header.level = job->level;
+    header.score = job->score;
+    header.block_count = block_count;
+    header.payload_size = payload_size;
+    header.payload_checksum = calculate_checksum(payload, payload_size);
+    header.checksum = calculate_checksum(&header, offsetof(save_delta_header_t, checksum));
+    memcpy(record, &header, sizeof(header));
+    
+    *size = sizeof(save_delta_header_t) + payload_size;
+    return record;
+}
+
+// True when a save in the group still has to replace path, so nothing
+// else may touch the slot before the group is committed
+static bool game_save_group_pending(game_save_group_t* group, const char* path) {
+    for (uint32_t i = 0; i < group->count; i++) {
+        if (group->renames[i] && strcmp(group->jobs[i]->path, path) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Writes a job into the saver's current group. A delta only goes to the
+// file the saver last wrote; otherwise, or once that file has too many
+// deltas, the slot is written in full from the job's copy. Nothing is
+// durable until the group is committed.
+static void game_saver_write(game_manager_t* gm, game_save_group_t* group, game_save_job_t* job) {
+    game_saver_t* saver = &gm->saver;
+    uint32_t index = group->count++;
+    group->jobs[index] = job;
+    group->fds[index] = -1;
+    group->renames[index] = false;
+    group->written[index] = false;
+    group->deltas[index] = false;
+    
+    char host_path[MAX_PATH];
+    bool host = game_host_path(gm, job->path, host_path, sizeof(host_path)) == 0;
+    
+    if (host && job->dirty && strcmp(saver->last_path, job->path) == 0 &&
+        saver->deltas < GAME_SAVE_MAX_DELTAS && saver->delta_bytes < sizeof(save_game_t) + job->size) {
+        uint32_t size;
+        uint8_t* record = game_save_delta_record(gm, job, saver->deltas + 1, &size);
+        int fd = record ? open(host_path, O_WRONLY | O_APPEND) : -1;
+        if (fd >= 0 && write(fd, record, size) == (ssize_t)size) {
+            group->fds[index] = fd;
+            group->written[index] = true;
+            group->deltas[index] = true;
+            saver->deltas++;
+            saver->delta_bytes += size;
+        } else if (fd >= 0) {
+            close(fd);
+        }
+        if (record) game_mem_free(gm, record);
+        if (group->written[index]) {
+            return;
+        }
+    }
+    
+    saver->last_path[0] = '\0';
+    save_game_t header;
+    game_save_full_header(job, &header);
+    
+    header.compression = GAME_COMPRESSION_NONE;
+    header.stored_size = job->size;
+    const uint8_t* stored = job->data;
+    uint8_t* packed = NULL;
+    if (job->compression == GAME_COMPRESSION_LZ && job->size > 0) {
+        uint32_t bound = game_lz_compress_bound(job->size);
+        packed = (uint8_t*)game_mem_alloc(gm, bound);
+        uint32_t packed_size = packed ? game_lz_compress(job->data, job->size, packed, bound) : 0;
+        if (packed_size > 0 && packed_size < job->size) {
+            header.compression = GAME_COMPRESSION_LZ;
+            header.stored_size = packed_size;
+            stored = packed;
+        }
+    }
+    header.checksum = calculate_checksum(&header, offsetof(save_game_t, checksum));
+    
+    if (host) {
+        // The header and the data go out in one call straight from the job
+        struct iovec parts[2] = { { &header, sizeof(save_game_t) }, { (void*)stored, header.stored_size } };
+        char temp_path[MAX_PATH + 4];
+        snprintf(temp_path, sizeof(temp_path), "%s.tmp", host_path);
+        int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd >= 0 && writev(fd, parts, 2) == (ssize_t)(sizeof(save_game_t) + header.stored_size)) {
+            group->fds[index] = fd;
+            group->renames[index] = true;
+            group->written[index] = true;
+        } else if (fd >= 0) {
+            close(fd);
+            unlink(temp_path);
+        }
+    } else {
+        // Without a host file the slot can only be rewritten in place
+        file_handle_t* save_file = game_fs_open(gm, job->path, 0x02); // Write mode
+        if (save_file) {
+            group->written[index] = game_fs_write(gm, save_file, &header, sizeof(save_game_t)) ==
+                                    sizeof(save_game_t) &&
+                                    game_fs_write(gm, save_file, stored, header.stored_size) == header.stored_size;
+            game_fs_close(gm, save_file);
+        }
+    }
+    if (packed) game_mem_free(gm, packed);
+    
+    if (!group->written[index]) {
+        printf("Failed to write save file: %s\n", job->path);
+        return;
+    }
+    strcpy(saver->last_path, job->path);
+    saver->deltas = 0;
+    saver->delta_bytes = 0;
+}
+
+static void game_save_sync_task(void* arg) {
+    game_save_sync_task_t* task = (game_save_sync_task_t*)arg;
+    task->result = fsync(task->fd);
+    game_group_done(task->group);
+}
+
+// Makes a group durable and reports it. The files are flushed side by
+// side on the worker pool, where journaling file systems fold the
+// concurrent fsyncs into one commit; then temporary files replace their
+// slots and each directory involved is flushed once.
+static void game_saver_commit(game_manager_t* gm, game_save_group_t* group) {
+    game_saver_t* saver = &gm->saver;
+    game_save_sync_task_t tasks[GAME_SAVE_GROUP_MAX];
+    
+    game_task_group_t flushes;
+    game_group_init(&flushes);
+    for (uint32_t i = 0; i < group->count; i++) {
+        if (group->fds[i] >= 0) {
+            tasks[i].fd = group->fds[i];
+            tasks[i].result = 0;
+            tasks[i].group = &flushes;
+            game_group_add(&flushes);
+            game_pool_submit(&gm->pool, game_save_sync_task, &tasks[i]);
+        }
+    }
+    game_group_wait(&flushes);
+    game_group_destroy(&flushes);
+    
+    for (uint32_t i = 0; i < group->count; i++) {
+        if (group->fds[i] < 0) {
+            continue;
+        }
+        close(group->fds[i]);
+        if (tasks[i].result != 0) {
+            group->written[i] = false;
+        }
+        
+        char host_path[MAX_PATH];
+        char temp_path[MAX_PATH + 4];
+        if (group->renames[i] && game_host_path(gm, group->jobs[i]->path, host_path, sizeof(host_path)) == 0) {
+            snprintf(temp_path, sizeof(temp_path), "%s.tmp", host_path);
+            if (!group->written[i] || rename(temp_path, host_path) != 0) {
+                unlink(temp_path);
+                group->written[i] = false;
+            }
+        }
+    }
+    
+    // One directory flush covers every slot replaced in it
+    bool synced[GAME_SAVE_GROUP_MAX] = {false};
+    for (uint32_t i = 0; i < group->count; i++) {
+        if (!group->renames[i] || !group->written[i] || synced[i]) {
+            continue;
+        }
+        
+        char directory[MAX_PATH];
+        size_t length = strrchr(group->jobs[i]->path, '/') - group->jobs[i]->path;
+        memcpy(directory, group->jobs[i]->path, length);
+        strcpy(directory + length, length ? "" : "/");
+        bool flushed = game_sync_directory(gm, directory) == 0;
+        
+        for (uint32_t j = i; j < group->count; j++) {
+            const char* path = group->jobs[j]->path;
+            if (group->renames[j] && strrchr(path, '/') - path == (ptrdiff_t)length &&
+                strncmp(path, group->jobs[i]->path, length) == 0) {
+                synced[j] = true;
+                group->written[j] = group->written[j] && flushed;
+            }
+        }
+    }
+    
+    for (uint32_t i = 0; i < group->count; i++) {
+        game_save_job_t* job = group->jobs[i];
+        game_save_status_t status = group->written[i] ? GAME_SAVE_DONE : GAME_SAVE_FAILED;
+        if (status == GAME_SAVE_DONE) {
+            printf("Game saved to slot %d%s\n", job->slot, group->deltas[i] ? " (delta)" : "");
+        } else {
+            // The slot may not hold what the saver thinks, so start over
+            saver->last_path[0] = '\0';
+        }
+        if (job->done) {
+            job->done(job->slot, status, job->user_data);
+        }
+        
+        pthread_mutex_lock(&saver->lock);
+        __atomic_store_n(&job->status, status, __ATOMIC_RELEASE);
+        saver->pending--;
+        pthread_cond_broadcast(&saver->wake);
+        pthread_mutex_unlock(&saver->lock);
+    }
+    group->count = 0;
+}
+
+// Takes everything queued at once, so saves requested while the last
+// group was being flushed share the next flush
+static void* game_saver_thread(void* arg) {
+    game_manager_t* gm = (game_manager_t*)arg;
+    game_saver_t* saver = &gm->saver;
+    game_save_group_t group;
+    group.count = 0;
+    
+    pthread_mutex_lock(&saver->lock);
+    for (;;) {
+        while (!saver->head && !saver->stopping) {
+            pthread_cond_wait(&saver->wake, &saver->lock);
+        }
+        if (!saver->head) {
+            break;
+        }
+        
+        game_save_job_t* jobs = saver->head;
+        saver->head = NULL;
+        saver->tail = NULL;
+        pthread_mutex_unlock(&saver->lock);
+        
+        while (jobs) {
+            game_save_job_t* job = jobs;
+            jobs = job->next;
+            if (group.count == GAME_SAVE_GROUP_MAX || game_save_group_pending(&group, job->path)) {
+                game_saver_commit(gm, &group);
+            }
+            game_saver_write(gm, &group, job);
+        }
+        game_saver_commit(gm, &group);
+        
+        pthread_mutex_lock(&saver->lock);
+    }
+    pthread_mutex_unlock(&saver->lock);
+    return NULL;
+}
+
+int game_saver_start(game_manager_t* gm) {
+    game_saver_t* saver = &gm->saver;
+    memset(saver, 0, sizeof(game_saver_t));
+    pthread_mutex_init(&saver->lock, NULL);
+    pthread_cond_init(&saver->wake, NULL);
+    if (pthread_create(&saver->thread, NULL, game_saver_thread, gm) != 0) {
+        pthread_cond_destroy(&saver->wake);
+        pthread_mutex_destroy(&saver->lock);
+        return -1;
+    }
+    saver->running = true;
+    return 0;
+}
+
+// Writes out the saves still queued, then stops the saver thread
+void game_saver_stop(game_manager_t* gm) {
+    game_saver_t* saver = &gm->saver;
+    if (!saver->running) {
+        return;
+    }
+    
+    pthread_mutex_lock(&saver->lock);
+    saver->stopping = true;
+    pthread_cond_broadcast(&saver->wake);
+    pthread_mutex_unlock(&saver->lock);
+    pthread_join(saver->thread, NULL);
+    
+    pthread_cond_destroy(&saver->wake);
+    pthread_mutex_destroy(&saver->lock);
+    saver->running = false;
+}
+
+// Starts saving the game's save region to a slot and returns immediately.
+// The region is copied before returning, so the game can keep changing
+// it; the saver thread writes the copy. The caller polls the job (or
+// waits for the callback) and must always hand it back through
+// game_save_finish.
+game_save_job_t* game_save_async(game_manager_t* gm, int slot, game_save_done_func done, void* user_data) {
+    if (!gm->current_game || slot < 0 || slot >= MAX_SAVE_SLOTS || !gm->saver.running) {
+        return NULL;
+    }
+    
+    game_instance_t* game = gm->current_game;
+    if (game_save_track(gm, game) != 0) {
+        return NULL;
+    }
+    
+    uint32_t region = game_save_region(game);
+    uint32_t blocks = (region + GAME_SAVE_BLOCK_SIZE - 1) / GAME_SAVE_BLOCK_SIZE;
+    const uint8_t* data = (const uint8_t*)game->data_memory;
+    bool delta = game->save_slot == (uint32_t)slot + 1;
+    
+    game_save_job_t* job = (game_save_job_t*)game_mem_alloc(gm, sizeof(game_save_job_t));
+    if (!job) {
+        printf("Failed to allocate save job\n");
+        return NULL;
+    }
+    memset(job, 0, sizeof(game_save_job_t));
+    job->data = (uint8_t*)game_mem_alloc(gm, region + 1);
+    job->dirty = delta ? (uint8_t*)game_mem_alloc(gm, blocks / 8 + 1) : NULL;
+    if (!job->data || (delta && !job->dirty)) {
+        printf("Failed to allocate save job\n");
+        if (job->data) game_mem_free(gm, job->data);
+        if (job->dirty) game_mem_free(gm, job->dirty);
+        game_mem_free(gm, job);
+        return NULL;
+    }
+    
+    snprintf(job->path, MAX_PATH, "%s_slot_%d.sav", game->save_path, slot);
+    job->slot = slot;
+    job->game_checksum = game->header.checksum;
+    job->save_time = time(NULL);
+    job->play_time = game->play_time;
+    job->level = game->current_level;
+    job->score = game->current_score;
+    job->size = region;
+    job->compression = game->save_compression[slot];
+    job->status = GAME_SAVE_PENDING;
+    job->done = done;
+    job->user_data = user_data;
+    memcpy(job->data, data, region);
+    
+    // Without marks, find the changed blocks by comparing with the slot
+    if (!game->save_marked) {
+        for (uint32_t block = 0; block < blocks; block++) {
+            uint32_t offset = block * GAME_SAVE_BLOCK_SIZE;
+            uint32_t length = region - offset < GAME_SAVE_BLOCK_SIZE ? region - offset : GAME_SAVE_BLOCK_SIZE;
+            if (memcmp(data + offset, game->save_shadow + offset, length) != 0) {
+                game->save_dirty[block / 8] |= (uint8_t)(1u << (block % 8));
+            }
+        }
+    }
+    if (delta) {
+        memcpy(job->dirty, game->save_dirty, blocks / 8 + 1);
+    }
+    
+    // Later saves are relative to this one
+    for (uint32_t block = 0; block < blocks; block++) {
+        uint32_t offset = block * GAME_SAVE_BLOCK_SIZE;
+        uint32_t length = region - offset < GAME_SAVE_BLOCK_SIZE ? region - offset : GAME_SAVE_BLOCK_SIZE;
+        if (!delta || ((game->save_dirty[block / 8] >> (block % 8)) & 1)) {
+            memcpy(game->save_shadow + offset, data + offset, length);
+        }
+    }
+    memset(game->save_dirty, 0, blocks / 8 + 1);
+    game->save_slot = (uint32_t)slot + 1;
+    game->has_save_data = true;
+    
+    game_saver_t* saver = &gm->saver;
+    pthread_mutex_lock(&saver->lock);
+    if (saver->tail) {
+        saver->tail->next = job;
+    } else {
+        saver->head = job;
+    }
+    saver->tail = job;
+    saver->pending++;
+    pthread_cond_broadcast(&saver->wake);
+    pthread_mutex_unlock(&saver->lock);
+    return job;
+}
+
+game_save_status_t game_save_poll(game_save_job_t* job) {
+    return (game_save_status_t)__atomic_load_n(&job->status, __ATOMIC_ACQUIRE);
+}
+
+// Waits for a save to be written and releases the job
+int game_save_finish(game_manager_t* gm, game_save_job_t* job) {
+    game_saver_t* saver = &gm->saver;
+    pthread_mutex_lock(&saver->lock);
+    while (__atomic_load_n(&job->status, __ATOMIC_ACQUIRE) == GAME_SAVE_PENDING) {
+        pthread_cond_wait(&saver->wake, &saver->lock);
+    }
+    pthread_mutex_unlock(&saver->lock);
+    
+    int result = job->status == GAME_SAVE_DONE ? 0 : -1;
+    game_mem_free(gm, job->data);
+    if (job->dirty) game_mem_free(gm, job->dirty);
+    game_mem_free(gm, job);
+    return result;
+}
+
+// Waits until every queued save is written
+void game_save_flush(game_manager_t* gm) {
+    game_saver_t* saver = &gm->saver;
+    pthread_mutex_lock(&saver->lock);
+    while (saver->pending > 0) {
+        pthread_cond_wait(&saver->wake, &saver->lock);
+    }
+    pthread_mutex_unlock(&saver->lock);
+}
+
+// Saves the game's save region to a slot and waits for it to be written.
+// When the slot holds the game's last save, only the blocks changed
+// since are appended to it.
+int game_save(game_manager_t* gm, int slot) {
+    game_save_job_t* job = game_save_async(gm, slot, NULL, NULL);
+    if (!job) {
+        return -1;
+    }
+    return game_save_finish(gm, job);
+}
+
+// Reads the data of a full save into dst, decompressing it through staging
+// when it is stored compressed, and checks it against the header
+static int game_save_read_data(game_manager_t* gm, file_handle_t* file, save_game_t* save, uint8_t* dst,
+                               uint8_t* staging, uint32_t staging_size) {
+    if (save->compression == GAME_COMPRESSION_NONE) {
+        if (save->stored_size != save->data_size ||
+            game_fs_read(gm, file, dst, save->data_size) != save->data_size) {
+            return -1;
+        }
+    } else if (save->compression == GAME_COMPRESSION_LZ) {
+        if ((save->data_size > 0 && save->stored_size == 0) ||
+            save->stored_size > game_lz_compress_bound(save->data_size)) {
+            return -1;
+        }
+        
+        game_lz_stream_t stream;
+        game_lz_stream_init(&stream, dst, save->data_size);
+        for (uint32_t done = 0; done < save->stored_size; ) {
+            uint32_t chunk = save->stored_size - done < staging_size ? save->stored_size - done : staging_size;
+            if (game_fs_read(gm, file, staging, chunk) != chunk ||
+                game_lz_stream_feed(&stream, staging, chunk) != 0) {
+                return -1;
+            }
+            done += chunk;
+        }
+        if (game_lz_stream_finish(&stream) != 0) {
+            return -1;
+        }
+    } else {
+        return -1;
+    }
+    
+    return calculate_checksum(dst, save->data_size) == save->data_checksum ? 0 : -1;
+}
+
+// Reads a slot's header, in any layout saves were written in, as a
+// current header. A versioned header leaves the file at its data. A
+// legacy record is read whole into record, which holds a
+// save_game_legacy_t, and reads as version 0 with its data left inline.
+// When it has no checksum, the bytes read past it begin the first delta
+// record; they go into delta and their count into carried.
+static int game_save_read_header(game_manager_t* gm, file_handle_t* file, save_game_t* save,
+                                 uint8_t* record, save_delta_header_t* delta, uint32_t* carried) {
+    const uint32_t prefix = 2 * sizeof(uint32_t);
+    uint32_t rest;
+    memset(save, 0, sizeof(save_game_t));
+    *carried = 0;
+    
+    // The second word tells the layouts apart: the version from
+    // GAME_SAVE_VERSION 2 on, the game checksum before that
+    if (game_fs_read(gm, file, save, prefix) != prefix || save->signature != SAVE_SIGNATURE) {
+        return -1;
+    }
+    
+    if (save->version == GAME_SAVE_VERSION) {
+        rest = sizeof(save_game_t) - prefix;
+        return game_fs_read(gm, file, (uint8_t*)save + prefix, rest) == rest &&
+               save->checksum == calculate_checksum(save, offsetof(save_game_t, checksum)) ? 0 : -1;
+    }
+    
+    if (save->version == 2) {
+        save_game_v2_t old;
+        memcpy(&old, save, prefix);
+        rest = sizeof(save_game_v2_t) - prefix;
+        if (game_fs_read(gm, file, (uint8_t*)&old + prefix, rest) != rest ||
+            old.checksum != calculate_checksum(&old, offsetof(save_game_v2_t, checksum))) {
+            return -1;
+        }
+        // Both layouts agree up to data_checksum
+        memcpy(save, &old, offsetof(save_game_v2_t, checksum));
+        save->compression = GAME_COMPRESSION_NONE;
+        save->stored_size = old.data_size;
+        return 0;
+    }
+    
+    save_game_legacy_t* legacy = (save_game_legacy_t*)record;
+    memcpy(legacy, save, prefix);
+    rest = offsetof(save_game_legacy_t, checksum) - prefix;
+    if (game_fs_read(gm, file, record + prefix, rest) != rest) {
+        return -1;
+    }
+    
+    // The first saves recorded the whole save_data_size but held at most
+    // save_data
+    uint32_t size = legacy->data_size < sizeof(legacy->save_data) ? legacy->data_size : sizeof(legacy->save_data);
+    uint32_t tail = game_fs_read(gm, file, &legacy->checksum, sizeof(uint32_t));
+    if (tail != sizeof(uint32_t) ||
+        legacy->checksum != calculate_checksum(legacy, offsetof(save_game_legacy_t, save_data) + size)) {
+        if (tail == sizeof(uint32_t) && legacy->checksum != SAVE_DELTA_SIGNATURE) {
+            return -1;
+        }
+        memcpy(delta, &legacy->checksum, tail);
+        *carried = tail;
+    }
+    
+    save->version = 0;
+    save->game_checksum = legacy->game_checksum;
+    save->save_time = legacy->save_time;
+    save->play_time = legacy->play_time;
+    save->level = legacy->level;
+    save->score = legacy->score;
+    save->data_size = size;
+    save->compression = GAME_COMPRESSION_NONE;
+    return 0;
+}
+
+// Loads a slot into the running game: the slot's full save, then its delta
+// records in order. Saves of another build of the game are refused. Slots
+// in an older layout load as well, and the next save rewrites them in the
+// current one.
+int game_load_save(game_manager_t* gm, int slot) {
+    if (!gm->current_game || slot < 0 || slot >= MAX_SAVE_SLOTS) {
+        return -1;
+    }
+    
+    game_instance_t* game = gm->current_game;
+    if (game_save_track(gm, game) != 0) {
+        return -1;
+    }
+    
+    char save_path[MAX_PATH];
+    snprintf(save_path, MAX_PATH, "%s_slot_%d.sav", game->save_path, slot);
+    
+    // Saves still queued for the slot have to land first
+    game_save_flush(gm);
+    
+    file_handle_t* save_file = game_fs_open(gm, save_path, 0x01); // Read mode
+    if (!save_file) {
+        printf("No save in slot %d\n", slot);
+        return -1;
+    }
+    
+    uint32_t region = game_save_region(game);
+    uint32_t blocks = (region + GAME_SAVE_BLOCK_SIZE - 1) / GAME_SAVE_BLOCK_SIZE;
+    uint32_t payload_capacity = blocks * (sizeof(uint32_t) + GAME_SAVE_BLOCK_SIZE);
+    uint8_t* payload = NULL;
+    uint8_t* staging = NULL;
+    uint32_t deltas = 0;
+    uint32_t delta_bytes = 0;
+    uint32_t carried = 0;
+    bool torn = false;
+    int result = -1;
+    
+    save_game_t save_data;
+    save_delta_header_t header;
+    bool valid;
+    
+    // Holds delta payloads; compressed base data and legacy records come
+    // in through staging
+    payload = (uint8_t*)game_mem_alloc(gm, payload_capacity + 1);
+    staging = (uint8_t*)game_mem_alloc(gm, GAME_SAVE_STAGING_SIZE);
+    if (!payload || !staging) {
+        goto cleanup;
+    }
+    
+    valid = game_save_read_header(gm, save_file, &save_data, staging, &header, &carried) == 0 &&
+            save_data.game_checksum == game->header.checksum;
+    if (valid && save_data.version == 0 && save_data.data_size > region) {
+        // Legacy records could hold more than the game's data image
+        save_data.data_size = region;
+    }
+    valid = valid && save_data.data_size <= region;
+    
+    // Rebuild the slot's save region in the shadow, reading the data
+    // straight into it, then take it over
+    if (valid) {
+        memcpy(game->save_shadow + save_data.data_size, (uint8_t*)game->data_memory + save_data.data_size,
+               region - save_data.data_size);
+        if (save_data.version == 0) {
+            memcpy(game->save_shadow, ((save_game_legacy_t*)staging)->save_data, save_data.data_size);
+        } else if (game_save_read_data(gm, save_file, &save_data, game->save_shadow,
+                                       staging, GAME_SAVE_STAGING_SIZE) != 0) {
+            // The shadow no longer matches the slot the game last saved to
+            game->save_slot = 0;
+            valid = false;
+        }
+    }
+    if (!valid) {
+        printf("Invalid save in slot %d\n", slot);
+        // Deltas must not pile onto a base that does not check out
+        pthread_mutex_lock(&gm->saver.lock);
+        gm->saver.last_path[0] = '\0';
+        pthread_mutex_unlock(&gm->saver.lock);
+        goto cleanup;
+    }
+    game->play_time = save_data.play_time;
+    game->current_level = save_data.level;
+    game->current_score = save_data.score;
+    
+    uint32_t bytes;
+    while ((bytes = carried + game_fs_read(gm, save_file, (uint8_t*)&header + carried,
+                                           sizeof(header) - carried)) != 0) {
+        carried = 0;
+        if (bytes != sizeof(header) || header.signature != SAVE_DELTA_SIGNATURE || header.sequence != deltas + 1 ||
+            header.checksum != calculate_checksum(&header, offsetof(save_delta_header_t, checksum)) ||
+            header.block_count > blocks || header.payload_size > payload_capacity ||
+            game_fs_read(gm, save_file, payload, header.payload_size) != header.payload_size ||
+            calculate_checksum(payload, header.payload_size) != header.payload_checksum) {
+            torn = true;
+            break;
+        }
+        
+        uint32_t position = 0;
+        for (uint32_t i = 0; i < header.block_count; i++) {
+            uint32_t block;
+            if (header.payload_size - position < sizeof(uint32_t)) {
+                break;
+            }
+            memcpy(&block, payload + position, sizeof(uint32_t));
+            position += sizeof(uint32_t);
+            
+            uint32_t offset = block * GAME_SAVE_BLOCK_SIZE;
+            uint32_t length = block < blocks && region - offset < GAME_SAVE_BLOCK_SIZE ?
+                              region - offset : GAME_SAVE_BLOCK_SIZE;
+            if (block >= blocks || header.payload_size - position < length) {
+                break;
+            }
+            memcpy(game->save_shadow + offset, payload + position, length);
+            position += length;
+        }
+        
+        game->play_time = header.play_time;
+        game->current_level = header.level;
+        game->current_score = header.score;
+        deltas++;
+        delta_bytes += sizeof(header) + header.payload_size;
+    }
+    
+    memcpy(game->data_memory, game->save_shadow, region);
+    memset(game->save_dirty, 0, blocks / 8 + 1);
+    game->save_slot = (uint32_t)slot + 1;
+    game->has_save_data = true;
+    
+    // Later deltas can follow the last record, unless a torn one follows
+    // it or the slot is in an older layout; then the next save rewrites it
+    pthread_mutex_lock(&gm->saver.lock);
+    strcpy(gm->saver.last_path, torn || save_data.version != GAME_SAVE_VERSION ? "" : save_path);
+    gm->saver.deltas = deltas;
+    gm->saver.delta_bytes = delta_bytes;
+    pthread_mutex_unlock(&gm->saver.lock);
+    
+    printf("Loaded save from slot %d (%d deltas)\n", slot, deltas);
+    result = 0;
+    
+cleanup:
+    game_fs_close(gm, save_file);
+    if (payload) game_mem_free(gm, payload);
+    if (staging) game_mem_free(gm, staging);
+    return result;
+}
+
+// Text of an interned string. Ids past the arena's end, which a damaged
+// catalog may hold, read as empty. Every string ends inside the
+// arena, which is zeroed past strings_used.
+static const char* game_registry_string(const game_registry_t* registry, uint32_t id) {
+    return id < registry->strings_used ? registry->strings + id : "";
+}
+
+// Id of an interned string, 0 if the registry has no such string. hash is
+// game_name_hash(text, false).
+static uint32_t game_registry_string_find(const game_registry_t* registry, const char* text, uint32_t hash) {
+    if (text[0] == '\0' || registry->capacity == 0) {
+        return 0;
+    }
+    
+    const game_index_slot_t* slots = registry->string_index;
+    uint32_t mask = registry->capacity * 4 - 1;
+    uint32_t i = hash & mask;
+    for (uint32_t probes = 0; probes <= mask && slots[i].entry; probes++, i = (i + 1) & mask) {
+        uint32_t id = slots[i].entry;
+        if (slots[i].hash == hash && id < registry->strings_used && strcmp(registry->strings + id, text) == 0) {
+            return id;
+        }
+    }
+    return 0;
+}
+
+// True when the arena and its index take bytes more in count new strings
+static bool game_registry_string_room(const game_registry_t* registry, size_t bytes, uint32_t count) {
+    return registry->strings_used + bytes <= registry->strings_size &&
+           registry->string_count + count <= registry->capacity * 3;
+}
+
+// Interns text cut to size - 1 bytes and returns its id. The caller makes
+// sure there is room.
+static uint32_t game_registry_intern(game_registry_t* registry, const char* text, size_t size) {
+    char cut[MAX_PATH];
+    size_t length = strnlen(text, size - 1);
+    if (length == 0) {
+        return 0;
+    }
+    memcpy(cut, text, length);
+    cut[length] = '\0';
+    
+    uint32_t hash = game_name_hash(cut, false);
+    uint32_t id = game_registry_string_find(registry, cut, hash);
+    if (id == 0) {
+        id = registry->strings_used;
+        memcpy(registry->strings + id, cut, length + 1);
+        registry->strings_used += (uint32_t)length + 1;
+        registry->string_count++;
+        game_index_insert(registry->string_index, registry->capacity * 4 - 1, hash, id);
+    }
+    return id;
+}
+
+// Copies an interned string cut to size - 1 bytes, staying inside the
+// arena when a racing writer left id stale
+static void game_registry_copy_string(const game_registry_t* registry, uint32_t id, char* text, size_t size) {
+    size_t length = 0;
+    if (id < registry->strings_used) {
+        size_t limit = registry->strings_size - id;
+        length = strnlen(registry->strings + id, limit < size - 1 ? limit : size - 1);
+        memcpy(text, registry->strings + id, length);
+    }
+    text[length] = '\0';
+}
+
+// Probes one of the name indexes. Safe on a registry being changed under
+// the reader: every index is bounds checked and the walk is bounded. Exact
+// lookups find the name's string id first and then compare ids.
+static int game_registry_find(const game_registry_t* registry, const char* name, bool fold) {
+    if (registry->capacity == 0) {
+        return -1;
+    }
+    
+    const game_index_slot_t* slots = fold ? registry->folded_index : registry->name_index;
+    uint32_t hash = game_name_hash(name, fold);
+    uint32_t id = fold ? 0 : game_registry_string_find(registry, name, hash);
+    if (!fold && id == 0) {
+        return -1;
+    }
+    
+    uint32_t mask = registry->capacity * 2 - 1;
+    uint32_t i = hash & mask;
+    for (uint32_t probes = 0; probes <= mask && slots[i].entry; probes++, i = (i + 1) & mask) {
+        uint32_t index = slots[i].entry - 1;
+        if (slots[i].hash == hash && index < registry->count &&
+            (fold ? strcasecmp(game_registry_string(registry, registry->names[index]), name) == 0
+                  : registry->names[index] == id)) {
+            return (int)index;
+        }
+    }
+    return -1;
+}
+
+static void game_registry_row(const game_registry_t* registry, uint32_t index, game_registry_entry_t* entry) {
+    memset(entry, 0, sizeof(game_registry_entry_t));
+    game_registry_copy_string(registry, registry->names[index], entry->name, MAX_GAME_NAME);
+    game_registry_copy_string(registry, registry->authors[index], entry->author, MAX_GAME_AUTHOR);
+    game_registry_copy_string(registry, registry->paths[index], entry->path, MAX_PATH);
+    entry->type = (game_type_t)registry->types[index];
+    entry->size = registry->sizes[index];
+    entry->last_played = registry->last_played[index];
+    entry->checksum = registry->checksums[index];
+    entry->is_installed = (registry->flags[index] & GAME_ENTRY_INSTALLED) != 0;
+}
+
+static int game_registry_find_synced(game_manager_t* gm, const char* name, bool fold,
+                                     game_registry_entry_t* entry) {
+    game_registry_snapshot_t* snapshot = game_registry_acquire(gm);
+    int index = game_registry_find(&snapshot->registry, name, fold);
+    if (index >= 0 && entry) {
+        game_registry_row(&snapshot->registry, (uint32_t)index, entry);
+    }
+    game_registry_release(gm, snapshot);
+    return index;
+}
+
+// Returns the row a name had when looked up. Rows move as games are
+// removed, so use game_registry_lookup for the entry itself.
+int game_find_by_name(game_manager_t* gm, const char* name) {
+    return game_registry_find_synced(gm, name, false, NULL);
+}
+
+// Names differing only in case all hash alike, so the first match wins
+int game_find_by_name_nocase(game_manager_t* gm, const char* name) {
+    return game_registry_find_synced(gm, name, true, NULL);
+}
+
+// Finds a game and copies its entry out in one consistent read
+int game_registry_lookup(game_manager_t* gm, const char* name, game_registry_entry_t* entry) {
+    return game_registry_find_synced(gm, name, false, entry);
+}
+
+// Updates the recency of the row a loaded entry came from, unless the
+// registry changed it meanwhile
+void game_registry_played(game_manager_t* gm, const game_registry_entry_t* entry, uint32_t when) {
+    game_registry_write_begin(gm);
+    int index = game_registry_find(&gm->registry, entry->name, false);
+    if (index >= 0 && strcmp(game_registry_string(&gm->registry, gm->registry.paths[index]), entry->path) == 0) {
+        game_registry_set_played(gm, (uint32_t)index, when);
+    }
+    game_registry_write_end(gm);
+}
+
+static uint32_t* game_order_ids(const game_registry_t* registry, game_sort_key_t order) {
+    if (order == GAME_SORT_SIZE) {
+        return registry->by_size;
+    }
+    return order == GAME_SORT_LAST_PLAYED ? registry->by_played : registry->by_type;
+}
+
+// Position of a row in a secondary order; smaller keys come first
+static uint64_t game_order_key(const game_registry_t* registry, game_sort_key_t order, uint32_t id) {
+    uint32_t recency = ~registry->last_played[id];
+    if (order == GAME_SORT_SIZE) {
+        return registry->sizes[id];
+    }
+    if (order == GAME_SORT_LAST_PLAYED) {
+        return recency;
+    }
+    return ((uint64_t)registry->types[id] << 32) | recency;
+}
+
+// First position among count whose key is not below key, or with upper,
+// not above it
+static uint32_t game_order_bound(const game_registry_t* registry, game_sort_key_t order, uint32_t count,
+                                 uint64_t key, bool upper) {
+    uint32_t* ids = game_order_ids(registry, order);
+    uint32_t low = 0;
+    uint32_t high = count;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        uint64_t current = game_order_key(registry, order, ids[middle]);
+        if (current < key || (upper && current == key)) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+// Finds a row among the first count ids of an order, using its current key
+static uint32_t game_order_find(game_registry_t* registry, game_sort_key_t order, uint32_t count, uint32_t id) {
+    uint32_t* ids = game_order_ids(registry, order);
+    uint32_t position = game_order_bound(registry, order, count, game_order_key(registry, order, id), false);
+    while (position < count && ids[position] != id) {
+        position++;
+    }
+    return position;
+}
+
+static void game_order_insert(game_registry_t* registry, game_sort_key_t order, uint32_t count, uint32_t id) {
+    uint32_t* ids = game_order_ids(registry, order);
+    uint32_t position = game_order_bound(registry, order, count, game_order_key(registry, order, id), true);
+    memmove(ids + position + 1, ids + position, (count - position) * sizeof(uint32_t));
+    ids[position] = id;
+}
+
+static void game_order_remove(game_registry_t* registry, game_sort_key_t order, uint32_t count, uint32_t id) {
+    uint32_t* ids = game_order_ids(registry, order);
+    uint32_t position = game_order_find(registry, order, count, id);
+    if (position < count) {
+        memmove(ids + position, ids + position + 1, (count - position - 1) * sizeof(uint32_t));
+    }
+}
+
+// Appends an entry to the registry, growing it when full, and indexes its
+// name. Returns the new row's index.
+int game_registry_add(game_manager_t* gm, const game_registry_entry_t* entry) {
+    game_registry_t* registry = &gm->registry;
+    size_t bytes = strnlen(entry->name, MAX_GAME_NAME - 1) + strnlen(entry->author, MAX_GAME_AUTHOR - 1) +
+                   strnlen(entry->path, MAX_PATH - 1) + 3;
+    if ((registry->count == registry->capacity || !game_registry_string_room(registry, bytes, 3)) &&
+        game_registry_rebuild(gm, registry->count + 1, bytes) != 0) {
+        printf("Failed to grow game registry\n");
+        return -1;
+    }
+    
+    uint32_t index = registry->count;
+    uint32_t mask = registry->capacity * 2 - 1;
+    gm->registry_sync.dirty |= GAME_SNAPSHOT_ALL;
+    registry->types[index] = (uint8_t)entry->type;
+    registry->flags[index] = entry->is_installed ? GAME_ENTRY_INSTALLED : 0;
+    registry->sizes[index] = entry->size;
+    registry->last_played[index] = entry->last_played;
+    registry->checksums[index] = entry->checksum;
+    registry->names[index] = game_registry_intern(registry, entry->name, MAX_GAME_NAME);
+    registry->authors[index] = game_registry_intern(registry, entry->author, MAX_GAME_AUTHOR);
+    registry->paths[index] = game_registry_intern(registry, entry->path, MAX_PATH);
+    
+    const char* name = game_registry_string(registry, registry->names[index]);
+    game_index_insert(registry->name_index, mask, game_name_hash(name, false), index + 1);
+    game_index_insert(registry->folded_index, mask, game_name_hash(name, true), index + 1);
+    for (int order = GAME_SORT_SIZE; order <= GAME_SORT_TYPE; order++) {
+        game_order_insert(registry, (game_sort_key_t)order, index, index);
+    }
+    
+    registry->count++;
+    game_catalog_touch(registry);
+    game_search_add(gm, index);
+    return (int)index;
+}
+
+// Removes a row by moving the last row into its place, so the last row's
+// index changes
+int game_registry_remove(game_manager_t* gm, uint32_t index) {
+    game_registry_t* registry = &gm->registry;
+    if (index >= registry->count) {
+        return -1;
+    }
+    
+    uint32_t mask = registry->capacity * 2 - 1;
+    gm->registry_sync.dirty |= GAME_SNAPSHOT_ALL;
+    const char* name = game_registry_string(registry, registry->names[index]);
+    game_index_remove(registry->name_index, mask, game_name_hash(name, false), index + 1);
+    game_index_remove(registry->folded_index, mask, game_name_hash(name, true), index + 1);
+    game_search_remove(gm, index);
+    
+    uint32_t last = registry->count - 1;
+    for (int order = GAME_SORT_SIZE; order <= GAME_SORT_TYPE; order++) {
+        game_order_remove(registry, (game_sort_key_t)order, registry->count, index);
+        if (index != last) {
+            // The last row keeps its place in the order under its new index
+            uint32_t* ids = game_order_ids(registry, (game_sort_key_t)order);
+            ids[game_order_find(registry, (game_sort_key_t)order, last, last)] = index;
+        }
+    }
+    
+    if (index != last) {
+        const char* last_name = game_registry_string(registry, registry->names[last]);
+        uint32_t hash = game_name_hash(last_name, false);
+        uint32_t folded = game_name_hash(last_name, true);
+        game_index_remove(registry->name_index, mask, hash, last + 1);
+        game_index_remove(registry->folded_index, mask, folded, last + 1);
+        
+        registry->types[index] = registry->types[last];
+        registry->flags[index] = registry->flags[last];
+        registry->sizes[index] = registry->sizes[last];
+        registry->last_played[index] = registry->last_played[last];
+        registry->checksums[index] = registry->checksums[last];
+        registry->names[index] = registry->names[last];
+        registry->authors[index] = registry->authors[last];
+        registry->paths[index] = registry->paths[last];
+        
+        game_index_insert(registry->name_index, mask, hash, index + 1);
+        game_index_insert(registry->folded_index, mask, folded, index + 1);
+    }
+    
+    registry->count--;
+    game_catalog_touch(registry);
+    return 0;
+}
+
+// Gathers a row into entry
+int game_registry_get(game_manager_t* gm, uint32_t index, game_registry_entry_t* entry) {
+    game_registry_snapshot_t* snapshot = game_registry_acquire(gm);
+    int result = index < snapshot->registry.count ? 0 : -1;
+    if (result == 0) {
+        game_registry_row(&snapshot->registry, index, entry);
+    }
+    game_registry_release(gm, snapshot);
+    return result;
+}
+
+static size_t game_registry_block_size(uint32_t capacity) {
+    return (size_t)capacity * 8 * sizeof(game_index_slot_t) +
+           (size_t)capacity * (9 * sizeof(uint32_t) + 2 * sizeof(uint8_t) + GAME_REGISTRY_STRING_BYTES);
+}
+
+// Points the columns into a block, widest columns first so every column
+// stays aligned. Memory and catalog blocks share this layout.
+static void game_registry_layout(game_registry_t* registry, uint8_t* block, uint32_t capacity) {
+    size_t slots = (size_t)capacity * 2;
+    registry->capacity = capacity;
+    registry->block = block;
+    registry->name_index = (game_index_slot_t*)block;
+    registry->folded_index = registry->name_index + slots;
+    registry->string_index = registry->folded_index + slots;
+    registry->sizes = (uint32_t*)(registry->string_index + slots * 2);
+    registry->last_played = registry->sizes + capacity;
+    registry->checksums = registry->last_played + capacity;
+    registry->by_size = registry->checksums + capacity;
+    registry->by_played = registry->by_size + capacity;
+    registry->by_type = registry->by_played + capacity;
+    registry->paths = registry->by_type + capacity;
+    registry->names = registry->paths + capacity;
+    registry->authors = registry->names + capacity;
+    registry->types = (uint8_t*)(registry->authors + capacity);
+    registry->flags = registry->types + capacity;
+    registry->strings = (char*)(registry->flags + capacity);
+    registry->strings_size = capacity * GAME_REGISTRY_STRING_BYTES;
+}
+
+static void game_registry_reindex(game_registry_t* registry) {
+    uint32_t mask = registry->capacity * 2 - 1;
+    memset(registry->name_index, 0, (size_t)registry->capacity * 2 * sizeof(game_index_slot_t) * 2);
+    for (uint32_t i = 0; i < registry->count; i++) {
+        const char* name = game_registry_string(registry, registry->names[i]);
+        game_index_insert(registry->name_index, mask, game_name_hash(name, false), i + 1);
+        game_index_insert(registry->folded_index, mask, game_name_hash(name, true), i + 1);
+    }
+}
+
+// Rebuilds the string index from the arena of a catalog that wasn't closed
+// cleanly, dropping ids that point past the strings that made it to disk
+static void game_registry_reindex_strings(game_registry_t* registry) {
+    uint32_t mask = registry->capacity * 4 - 1;
+    if (registry->strings_used == 0 || registry->strings_used > registry->strings_size) {
+        registry->strings_used = 1;
+    }
+    registry->strings[0] = '\0';
+    registry->strings[registry->strings_used - 1] = '\0';
+    memset(registry->strings + registry->strings_used, 0, registry->strings_size - registry->strings_used);
+    
+    memset(registry->string_index, 0, (size_t)registry->capacity * 4 * sizeof(game_index_slot_t));
+    registry->string_count = 0;
+    for (uint32_t id = 1; id < registry->strings_used;) {
+        uint32_t length = (uint32_t)strlen(registry->strings + id);
+        if (length > 0 && registry->string_count < registry->capacity * 3) {
+            game_index_insert(registry->string_index, mask, game_name_hash(registry->strings + id, false), id);
+            registry->string_count++;
+        }
+        id += length + 1;
+    }
+    
+    for (uint32_t i = 0; i < registry->count; i++) {
+        if (registry->names[i] >= registry->strings_used) registry->names[i] = 0;
+        if (registry->authors[i] >= registry->strings_used) registry->authors[i] = 0;
+        if (registry->paths[i] >= registry->strings_used) registry->paths[i] = 0;
+    }
+}
+
+// Checks a catalog adopted on trust against the block checksum it was
+// closed with, and recovers it like an unclean one when they differ. Runs
+// inside a write batch, before the batch changes the block.
+static void game_catalog_verify(game_manager_t* gm) {
+    game_registry_t* registry = &gm->registry;
+    if (!gm->registry_sync.verify_pending) {
+        return;
+    }
+    gm->registry_sync.verify_pending = false;
+    if (!registry->catalog ||
+        calculate_checksum(registry->block, registry->catalog->block_size) == registry->catalog->data_checksum) {
+        return;
+    }
+    
+    printf("Recovering registry catalog\n");
+    game_registry_reindex_strings(registry);
+    game_registry_reindex(registry);
+    game_registry_rebuild_orders(gm);
+    game_search_free(gm);
+}
+
+// Verifies an adopted catalog off the boot path, unless a batch got to it
+// first
+static void game_catalog_verify_task(void* arg) {
+    game_manager_t* gm = (game_manager_t*)arg;
+    game_registry_write_begin(gm);
+    game_registry_write_end(gm);
+}
+
+// Read by readers before the first batch is published
+static game_registry_snapshot_t game_registry_empty;
+
+// Pins the registry as the last finished batch left it. Never waits; the
+// snapshot stays valid and unchanged until released.
+game_registry_snapshot_t* game_registry_acquire(game_manager_t* gm) {
+    game_registry_sync_t* sync = &gm->registry_sync;
+    __atomic_fetch_add(&sync->acquiring, 1, __ATOMIC_SEQ_CST);
+    game_registry_snapshot_t* snapshot = __atomic_load_n(&sync->current, __ATOMIC_SEQ_CST);
+    if (snapshot) {
+        __atomic_fetch_add(&snapshot->pins, 1, __ATOMIC_SEQ_CST);
+    } else {
+        snapshot = &game_registry_empty;
+    }
+    __atomic_fetch_sub(&sync->acquiring, 1, __ATOMIC_SEQ_CST);
+    return snapshot;
+}
+
+void game_registry_release(game_manager_t* gm, game_registry_snapshot_t* snapshot) {
+    (void)gm;
+    if (snapshot != &game_registry_empty) {
+        __atomic_fetch_sub(&snapshot->pins, 1, __ATOMIC_RELEASE);
+    }
+}
+
+static void game_snapshot_part_put(game_manager_t* gm, game_snapshot_part_t* part) {
+    if (part && --part->refs == 0) {
+        game_mem_free(gm, part);
+    }
+}
+
+static void game_snapshot_free(game_manager_t* gm, game_registry_snapshot_t* snapshot) {
+    for (uint32_t i = 0; i < GAME_SNAPSHOT_PARTS; i++) {
+        game_snapshot_part_put(gm, snapshot->parts[i]);
+    }
+    game_mem_free(gm, snapshot);
+}
+
+// Frees retired snapshots no reader holds. A reader still acquiring may
+// be about to pin any of them, so nothing is freed while one is.
+static void game_registry_reclaim(game_manager_t* gm) {
+    game_registry_sync_t* sync = &gm->registry_sync;
+    if (!sync->retired || __atomic_load_n(&sync->acquiring, __ATOMIC_SEQ_CST) != 0) {
+        return;
+    }
+    
+    game_registry_snapshot_t** link = &sync->retired;
+    while (*link) {
+        game_registry_snapshot_t* snapshot = *link;
+        if (__atomic_load_n(&snapshot->pins, __ATOMIC_ACQUIRE) == 0) {
+            *link = snapshot->next;
+            game_snapshot_free(gm, snapshot);
+        } else {
+            link = &snapshot->next;
+        }
+    }
+}
+
+// Allocates a part for size bytes of data, which follow it
+static game_snapshot_part_t* game_snapshot_part_alloc(game_manager_t* gm, size_t size) {
+    if (size > 0xFFFFFFFFu - sizeof(game_snapshot_part_t)) {
+        return NULL;
+    }
+    game_snapshot_part_t* part = (game_snapshot_part_t*)game_mem_alloc(gm, (uint32_t)(sizeof(game_snapshot_part_t) + size));
+    if (part) {
+        part->refs = 1;
+        part->size = (uint32_t)size;
+    }
+    return part;
+}
+
+// Copies the indexes, the row columns other than recency, the size order
+// and the strings in use. Indexes keep their full size, so lookups hash as
+// they do in the registry.
+static game_snapshot_part_t* game_snapshot_copy_rows(game_manager_t* gm, game_registry_t* frozen) {
+    game_registry_t* registry = &gm->registry;
+    size_t slots = (size_t)registry->capacity * 8;
+    size_t count = registry->count;
+    game_snapshot_part_t* part = game_snapshot_part_alloc(gm, slots * sizeof(game_index_slot_t) +
+                                                          count * (6 * sizeof(uint32_t) + 2) + registry->strings_used);
+    if (!part) {
+        return NULL;
+    }
+    
+    uint8_t* data = (uint8_t*)(part + 1);
+    if (slots > 0) {
+        memcpy(data, registry->name_index, slots * sizeof(game_index_slot_t));
+    }
+    frozen->name_index = (game_index_slot_t*)data;
+    frozen->folded_index = frozen->name_index + slots / 4;
+    frozen->string_index = frozen->folded_index + slots / 4;
+    
+    uint32_t* columns = (uint32_t*)(frozen->name_index + slots);
+    uint32_t* sources[6] = { registry->sizes, registry->checksums, registry->by_size,
+                             registry->names, registry->authors, registry->paths };
+    uint32_t** targets[6] = { &frozen->sizes, &frozen->checksums, &frozen->by_size,
+                              &frozen->names, &frozen->authors, &frozen->paths };
+    for (int i = 0; i < 6; i++) {
+        *targets[i] = columns;
+        if (count > 0) {
+            memcpy(columns, sources[i], count * sizeof(uint32_t));
+        }
+        columns += count;
+    }
+    
+    frozen->types = (uint8_t*)columns;
+    frozen->flags = frozen->types + count;
+    frozen->strings = (char*)(frozen->flags + count);
+    if (count > 0) {
+        memcpy(frozen->types, registry->types, count);
+        memcpy(frozen->flags, registry->flags, count);
+    }
+    if (registry->strings_used > 0) {
+        memcpy(frozen->strings, registry->strings, registry->strings_used);
+    }
+    frozen->strings_size = registry->strings_used;
+    return part;
+}
+
+static game_snapshot_part_t* game_snapshot_copy_recency(game_manager_t* gm, game_registry_t* frozen) {
+    game_registry_t* registry = &gm->registry;
+    size_t count = registry->count;
+    game_snapshot_part_t* part = game_snapshot_part_alloc(gm, count * 3 * sizeof(uint32_t));
+    if (!part) {
+        return NULL;
+    }
+    
+    frozen->last_played = (uint32_t*)(part + 1);
+    frozen->by_played = frozen->last_played + count;
+    frozen->by_type = frozen->by_played + count;
+    if (count > 0) {
+        memcpy(frozen->last_played, registry->last_played, count * sizeof(uint32_t));
+        memcpy(frozen->by_played, registry->by_played, count * sizeof(uint32_t));
+        memcpy(frozen->by_type, registry->by_type, count * sizeof(uint32_t));
+    }
+    return part;
+}
+
+// Copies the search index with its postings packed after the table, each
+// list sized to fit
+static game_snapshot_part_t* game_snapshot_copy_search(game_manager_t* gm, game_search_t* frozen) {
+    game_search_t* search = &gm->search;
+    size_t table_bytes = (size_t)search->table_capacity * sizeof(game_search_postings_t);
+    size_t words = search->doc_count;
+    for (uint32_t i = 0; i < search->table_capacity; i++) {
+        words += search->table[i].count;
+    }
+    game_snapshot_part_t* part = game_snapshot_part_alloc(gm, table_bytes + words * sizeof(uint32_t));
+    if (!part) {
+        return NULL;
+    }
+    
+    uint8_t* data = (uint8_t*)(part + 1);
+    memset(frozen, 0, sizeof(game_search_t));
+    frozen->built = search->built;
+    frozen->table = (game_search_postings_t*)data;
+    frozen->table_capacity = search->table_capacity;
+    frozen->key_count = search->key_count;
+    frozen->doc_rows = (uint32_t*)(data + table_bytes);
+    frozen->doc_count = search->doc_count;
+    frozen->deleted = search->deleted;
+    if (search->doc_count > 0) {
+        memcpy(frozen->doc_rows, search->doc_rows, search->doc_count * sizeof(uint32_t));
+    }
+    
+    uint32_t* docs = frozen->doc_rows + search->doc_count;
+    for (uint32_t i = 0; i < search->table_capacity; i++) {
+        game_search_postings_t* postings = &frozen->table[i];
+        *postings = search->table[i];
+        postings->capacity = postings->count;
+        postings->docs = postings->count ? docs : NULL;
+        if (postings->count > 0) {
+            memcpy(docs, search->table[i].docs, postings->count * sizeof(uint32_t));
+            docs += postings->count;
+        }
+    }
+    return part;
+}
+
+// Builds the next snapshot from the registry, copying the parts marked
+// dirty and sharing the rest with the current snapshot
+static game_registry_snapshot_t* game_registry_snapshot(game_manager_t* gm) {
+    game_registry_sync_t* sync = &gm->registry_sync;
+    game_registry_t* registry = &gm->registry;
+    game_registry_snapshot_t* previous = sync->current;
+    uint32_t dirty = sync->dirty;
+    if (!previous || previous->registry.count != registry->count ||
+        previous->registry.capacity != registry->capacity) {
+        dirty = GAME_SNAPSHOT_ALL;
+    }
+    
+    game_registry_snapshot_t* snapshot = (game_registry_snapshot_t*)game_mem_alloc(gm, sizeof(game_registry_snapshot_t));
+    if (!snapshot) {
+        return NULL;
+    }
+    memset(snapshot, 0, sizeof(game_registry_snapshot_t));
+    if (previous) {
+        snapshot->registry = previous->registry;
+        snapshot->search = previous->search;
+    }
+    snapshot->registry.count = registry->count;
+    snapshot->registry.capacity = registry->capacity;
+    snapshot->registry.strings_used = registry->strings_used;
+    snapshot->registry.string_count = registry->string_count;
+    
+    for (uint32_t i = 0; i < GAME_SNAPSHOT_PARTS; i++) {
+        if (!(dirty & (1u << i))) {
+            snapshot->parts[i] = previous->parts[i];
+            snapshot->parts[i]->refs++;
+        } else if (i == GAME_SNAPSHOT_ROWS) {
+            snapshot->parts[i] = game_snapshot_copy_rows(gm, &snapshot->registry);
+        } else if (i == GAME_SNAPSHOT_RECENCY) {
+            snapshot->parts[i] = game_snapshot_copy_recency(gm, &snapshot->registry);
+        } else {
+            snapshot->parts[i] = game_snapshot_copy_search(gm, &snapshot->search);
+        }
+        
+        if (!snapshot->parts[i]) {
+            game_snapshot_free(gm, snapshot);
+            return NULL;
+        }
+    }
+    return snapshot;
+}
+
+// Starts a batch of changes. Readers keep seeing the last snapshot until
+// game_registry_write_end publishes the whole batch.
+void game_registry_write_begin(game_manager_t* gm) {
+    pthread_mutex_lock(&gm->registry_sync.writer);
+    game_catalog_verify(gm);
+}
+
+// Publishes the batch as a new snapshot. Returns -1 when that fails; readers
+// then keep the previous snapshot, and the next batch publishes this one's
+// changes along with its own.
+int game_registry_write_end(game_manager_t* gm) {
+    game_registry_sync_t* sync = &gm->registry_sync;
+    
+    // Queries only see the index through snapshots, so it is kept built
+    game_search_t* search = &gm->search;
+    if (!search->built || search->deleted > search->doc_count / 2 + 1024) {
+        game_search_build(gm);
+    }
+    
+    int result = 0;
+    game_registry_snapshot_t* snapshot = game_registry_snapshot(gm);
+    if (snapshot) {
+        snapshot->sequence = ++sync->sequence;
+        game_registry_snapshot_t* previous = sync->current;
+        __atomic_store_n(&sync->current, snapshot, __ATOMIC_SEQ_CST);
+        if (previous) {
+            previous->next = sync->retired;
+            sync->retired = previous;
+        }
+        sync->dirty = 0;
+    } else {
+        printf("Failed to publish registry snapshot\n");
+        result = -1;
+    }
+    game_registry_reclaim(gm);
+    pthread_mutex_unlock(&sync->writer);
+    return result;
+}
+
+// Records the row count in the catalog header. Rows themselves are
+// written through the shared mapping, so only changed pages go back to
+// the file.
+void game_catalog_touch(game_registry_t* registry) {
+    game_catalog_header_t* header = registry->catalog;
+    if (header) {
+        header->count = registry->count;
+        header->strings_used = registry->strings_used;
+        header->string_count = registry->string_count;
+        header->checksum = calculate_checksum(header, offsetof(game_catalog_header_t, checksum));
+    }
+}
+
+// Creates an empty catalog file sized for capacity rows and maps it
+static game_catalog_header_t* game_catalog_create(game_manager_t* gm, const char* path,
+                                                  uint32_t capacity, size_t* size) {
+    char host_path[MAX_PATH];
+    if (game_host_path(gm, path, host_path, sizeof(host_path)) != 0) {
+        return NULL;
+    }
+    
+    size_t block_size = game_registry_block_size(capacity);
+    *size = GAME_CATALOG_DATA_OFFSET + block_size;
+    int fd = open(host_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return NULL;
+    }
+    
+    void* mapping = MAP_FAILED;
+    if (ftruncate(fd, (off_t)*size) == 0) {
+        mapping = mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        unlink(host_path);
+        return NULL;
+    }
+    
+    game_catalog_header_t* header = (game_catalog_header_t*)mapping;
+    header->signature = CATALOG_SIGNATURE;
+    header->version = GAME_CATALOG_VERSION;
+    header->capacity = capacity;
+    header->block_size = (uint32_t)block_size;
+    return header;
+}
+
+// Marks the catalog clean, with a checksum of its block, and unmaps it
+static void game_catalog_close(game_manager_t* gm) {
+    game_registry_t* registry = &gm->registry;
+    game_catalog_header_t* header = registry->catalog;
+    
+    // A block never checked must not be vouched for by a fresh checksum
+    game_catalog_verify(gm);
+    header->data_checksum = calculate_checksum(registry->block, header->block_size);
+    header->clean = 1;
+    game_catalog_touch(registry);
+    msync(header, registry->catalog_size, MS_SYNC);
+    munmap(header, registry->catalog_size);
+    registry->catalog = NULL;
+    registry->catalog_size = 0;
+}
+
+// Grows the registry to hold at least capacity rows
+int game_registry_reserve(game_manager_t* gm, uint32_t capacity) {
+    if (capacity <= gm->registry.capacity) {
+        return 0;
+    }
+    return game_registry_rebuild(gm, capacity, 0);
+}
+
+// Copies the registry into a new block, in memory or as a new catalog file
+// that replaces the old one. Strings are interned again, which drops the
+// ones no row uses. The block holds at least capacity rows, and is grown
+// further so that the live strings plus string_bytes more fill at most
+// half the arena. Name indexes are rebuilt at their new size.
+int game_registry_rebuild(game_manager_t* gm, uint32_t capacity, size_t string_bytes) {
+    game_registry_t* registry = &gm->registry;
+    uint32_t count = registry->count;
+    gm->registry_sync.dirty |= GAME_SNAPSHOT_ALL;
+    
+    size_t live_bytes = 1 + string_bytes;
+    size_t live_count = 3;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t ids[3] = { registry->names[i], registry->authors[i], registry->paths[i] };
+        for (int j = 0; j < 3; j++) {
+            if (ids[j] != 0) {
+                live_bytes += strlen(game_registry_string(registry, ids[j])) + 1;
+                live_count++;
+            }
+        }
+    }
+    
+    uint32_t size = registry->capacity ? registry->capacity : GAME_REGISTRY_MIN_CAPACITY;
+    while (size < capacity || (size_t)size * GAME_REGISTRY_STRING_BYTES < live_bytes * 2 ||
+           (size_t)size * 2 < live_count) {
+        if (size > 0x7FFFFFFFu / 2) {
+            return -1;
+        }
+        size *= 2;
+    }
+    
+    size_t bytes = game_registry_block_size(size);
+    if (bytes > 0xFFFFFFFFu - GAME_CATALOG_DATA_OFFSET) {
+        return -1;
+    }
+    
+    game_registry_t grown;
+    memset(&grown, 0, sizeof(game_registry_t));
+    
+    uint8_t* block;
+    if (registry->catalog) {
+        grown.catalog = game_catalog_create(gm, GAME_CATALOG_PATH ".new", size, &grown.catalog_size);
+        if (!grown.catalog) {
+            return -1;
+        }
+        block = (uint8_t*)grown.catalog + GAME_CATALOG_DATA_OFFSET;
+    } else {
+        block = (uint8_t*)game_mem_alloc(gm, (uint32_t)bytes);
+        if (!block) {
+            return -1;
+        }
+        memset(block, 0, bytes);
+    }
+    game_registry_layout(&grown, block, size);
+    grown.strings_used = 1;
+    
+    grown.count = count;
+    if (count > 0) {
+        memcpy(grown.sizes, registry->sizes, count * sizeof(uint32_t));
+        memcpy(grown.last_played, registry->last_played, count * sizeof(uint32_t));
+        memcpy(grown.checksums, registry->checksums, count * sizeof(uint32_t));
+        memcpy(grown.by_size, registry->by_size, count * sizeof(uint32_t));
+        memcpy(grown.by_played, registry->by_played, count * sizeof(uint32_t));
+        memcpy(grown.by_type, registry->by_type, count * sizeof(uint32_t));
+        memcpy(grown.types, registry->types, count);
+        memcpy(grown.flags, registry->flags, count);
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        grown.names[i] = game_registry_intern(&grown, game_registry_string(registry, registry->names[i]),
+                                              MAX_GAME_NAME);
+        grown.authors[i] = game_registry_intern(&grown, game_registry_string(registry, registry->authors[i]),
+                                                MAX_GAME_AUTHOR);
+        grown.paths[i] = game_registry_intern(&grown, game_registry_string(registry, registry->paths[i]),
+                                              MAX_PATH);
+    }
+    game_registry_reindex(&grown);
+    
+    if (registry->catalog) {
+        char old_path[MAX_PATH];
+        char new_path[MAX_PATH];
+        game_host_path(gm, GAME_CATALOG_PATH, old_path, sizeof(old_path));
+        game_host_path(gm, GAME_CATALOG_PATH ".new", new_path, sizeof(new_path));
+        
+        game_catalog_touch(&grown);
+        if (msync(grown.catalog, grown.catalog_size, MS_SYNC) != 0 || rename(new_path, old_path) != 0) {
+            munmap(grown.catalog, grown.catalog_size);
+            unlink(new_path);
+            return -1;
+        }
+        munmap(registry->catalog, registry->catalog_size);
+    } else if (registry->block) {
+        game_mem_free(gm, registry->block);
+    }
+    *registry = grown;
+    return 0;
+}
+
+void game_registry_free(game_manager_t* gm) {
+    game_search_free(gm);
+    if (gm->registry.catalog) {
+        game_catalog_close(gm);
+    } else if (gm->registry.block) {
+        game_mem_free(gm, gm->registry.block);
+    }
+    memset(&gm->registry, 0, sizeof(game_registry_t));
+    
+    // Readers are done by now, so the published snapshot goes as well
+    game_registry_sync_t* sync = &gm->registry_sync;
+    if (sync->current) {
+        sync->current->next = sync->retired;
+        sync->retired = sync->current;
+        sync->current = NULL;
+    }
+    game_registry_reclaim(gm);
+}
+
+// Maps the catalog under the host root and makes it the registry's backing
+// store. A valid catalog is used as is, so attaching does not depend on the
+// number of games; rows only in memory, such as the built-in games, are
+// added to it. Otherwise a new catalog is written from the registry. A
+// catalog that wasn't closed cleanly has its string ids checked and its
+// indexes and orders rebuilt. A clean one is checked against its block
+// checksum in the background, before any batch changes it.
+int game_catalog_attach(game_manager_t* gm) {
+    game_registry_t* registry = &gm->registry;
+    char host_path[MAX_PATH];
+    if (registry->catalog || game_host_path(gm, GAME_CATALOG_PATH, host_path, sizeof(host_path)) != 0) {
+        return -1;
+    }
+    
+    game_registry_t attached;
+    memset(&attached, 0, sizeof(game_registry_t));
+    
+    int fd = open(host_path, O_RDWR);
+    if (fd >= 0) {
+        struct stat st;
+        game_catalog_header_t header;
+        if (pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+            header.signature == CATALOG_SIGNATURE && header.version == GAME_CATALOG_VERSION &&
+            header.checksum == calculate_checksum(&header, offsetof(game_catalog_header_t, checksum)) &&
+            header.capacity >= GAME_REGISTRY_MIN_CAPACITY && (header.capacity & (header.capacity - 1)) == 0 &&
+            header.capacity <= 0x7FFFFFFFu / 2 && header.count <= header.capacity &&
+            header.block_size == game_registry_block_size(header.capacity) &&
+            header.strings_used >= 1 && header.strings_used <= header.capacity * GAME_REGISTRY_STRING_BYTES &&
+            fstat(fd, &st) == 0 && st.st_size >= (off_t)(GAME_CATALOG_DATA_OFFSET + (size_t)header.block_size)) {
+            attached.catalog_size = GAME_CATALOG_DATA_OFFSET + (size_t)header.block_size;
+            void* mapping = mmap(NULL, attached.catalog_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (mapping != MAP_FAILED) {
+                attached.catalog = (game_catalog_header_t*)mapping;
+            }
+        }
+        close(fd);
+    }
+    
+    bool recovered = false;
+    bool trusted = false;
+    if (attached.catalog) {
+        game_registry_layout(&attached, (uint8_t*)attached.catalog + GAME_CATALOG_DATA_OFFSET,
+                             attached.catalog->capacity);
+        attached.count = attached.catalog->count;
+        attached.strings_used = attached.catalog->strings_used;
+        attached.string_count = attached.catalog->string_count;
+        
+        if (!attached.catalog->clean) {
+            printf("Recovering registry catalog\n");
+            recovered = true;
+            game_registry_reindex_strings(&attached);
+            game_registry_reindex(&attached);
+        } else {
+            trusted = true;
+        }
+    } else {
+        uint32_t capacity = registry->capacity ? registry->capacity : GAME_REGISTRY_MIN_CAPACITY;
+        attached.catalog = game_catalog_create(gm, GAME_CATALOG_PATH, capacity, &attached.catalog_size);
+        if (!attached.catalog) {
+            return -1;
+        }
+        game_registry_layout(&attached, (uint8_t*)attached.catalog + GAME_CATALOG_DATA_OFFSET, capacity);
+        attached.strings_used = 1;
+        if (registry->block) {
+            memcpy(attached.block, registry->block, game_registry_block_size(capacity));
+            attached.strings_used = registry->strings_used;
+            attached.string_count = registry->string_count;
+        }
+        attached.count = registry->count;
+    }
+    
+    attached.catalog->clean = 0;
+    game_catalog_touch(&attached);
+    msync(attached.catalog, GAME_CATALOG_DATA_OFFSET, MS_SYNC);
+    
+    // Carry over rows the catalog doesn't have yet. Rows are renumbered, so
+    // the search index starts over.
+    game_search_free(gm);
+    game_registry_t previous = *registry;
+    *registry = attached;
+    gm->registry_sync.dirty |= GAME_SNAPSHOT_ALL;
+    if (recovered) {
+        // Orders may be mid-update in a catalog that wasn't closed cleanly
+        game_registry_rebuild_orders(gm);
+    } else if (trusted) {
+        gm->registry_sync.verify_pending = true;
+        game_pool_submit(&gm->pool, game_catalog_verify_task, gm);
+    }
+    for (uint32_t i = 0; i < previous.count; i++) {
+        if (game_registry_find(registry, game_registry_string(&previous, previous.names[i]), false) < 0) {
+            game_registry_entry_t entry;
+            game_registry_row(&previous, i, &entry);
+            game_catalog_verify(gm);
+            game_registry_add(gm, &entry);
+        }
+    }
+    if (previous.block) {
+        game_mem_free(gm, previous.block);
+    }
+    return 0;
+}
+
+// Moves the registry back into memory and closes the catalog
+int game_catalog_detach(game_manager_t* gm) {
+    game_registry_t* registry = &gm->registry;
+    if (!registry->catalog) {
+        return 0;
+    }
+    
+    size_t bytes = game_registry_block_size(registry->capacity);
+    uint8_t* block = (uint8_t*)game_mem_alloc(gm, (uint32_t)bytes);
+    if (!block) {
+        return -1;
+    }
+    memcpy(block, registry->block, bytes);
+    
+    game_catalog_close(gm);
+    game_registry_layout(registry, block, registry->capacity);
+    return 0;
+}
+
+// Records when a game was last played and moves it in the recency orders
+int game_registry_set_played(game_manager_t* gm, uint32_t index, uint32_t when) {
+    game_registry_t* registry = &gm->registry;
+    if (index >= registry->count) {
+        return -1;
+    }
+    
+    // Only the recency part of the next snapshot is copied
+    gm->registry_sync.dirty |= 1u << GAME_SNAPSHOT_RECENCY;
+    game_order_remove(registry, GAME_SORT_LAST_PLAYED, registry->count, index);
+    game_order_remove(registry, GAME_SORT_TYPE, registry->count, index);
+    registry->last_played[index] = when;
+    game_order_insert(registry, GAME_SORT_LAST_PLAYED, registry->count - 1, index);
+    game_order_insert(registry, GAME_SORT_TYPE, registry->count - 1, index);
+    return 0;
+}
+
+// Views a whole secondary order of a snapshot without copying
+int game_registry_view(const game_registry_snapshot_t* snapshot, game_sort_key_t order, game_registry_view_t* view) {
+    if (order < GAME_SORT_SIZE || order > GAME_SORT_TYPE) {
+        return -1;
+    }
+    
+    view->ids = game_order_ids(&snapshot->registry, order);
+    view->count = snapshot->registry.count;
+    return 0;
+}
+
+// Views the games of one type, most recently played first, as a slice of
+// the type order
+int game_registry_view_type(const game_registry_snapshot_t* snapshot, game_type_t type, game_registry_view_t* view) {
+    const game_registry_t* registry = &snapshot->registry;
+    if ((uint32_t)type > 0xFF) {
+        return -1;
+    }
+    
+    uint64_t first = (uint64_t)type << 32;
+    uint32_t start = game_order_bound(registry, GAME_SORT_TYPE, registry->count, first, false);
+    uint32_t end = game_order_bound(registry, GAME_SORT_TYPE, registry->count, first | 0xFFFFFFFFu, true);
+    view->ids = registry->by_type ? registry->by_type + start : NULL;
+    view->count = end - start;
+    return 0;
+}
+
+// Re-sorts every secondary order from the columns, for catalogs that were
+// not closed cleanly
+int game_registry_rebuild_orders(game_manager_t* gm) {
+    game_registry_t* registry = &gm->registry;
+    gm->registry_sync.dirty |= (1u << GAME_SNAPSHOT_ROWS) | (1u << GAME_SNAPSHOT_RECENCY);
+    for (uint32_t i = 0; i < registry->count; i++) {
+        registry->by_size[i] = i;
+        registry->by_played[i] = i;
+    }
+    
+    if (game_registry_sort(gm, registry->by_size, registry->count, GAME_SORT_SIZE) != 0 ||
+        game_registry_sort(gm, registry->by_played, registry->count, GAME_SORT_LAST_PLAYED) != 0) {
+        return -1;
+    }
+    
+    // A stable sort by type keeps recency order within each type
+    if (registry->count > 0) {
+        memcpy(registry->by_type, registry->by_played, registry->count * sizeof(uint32_t));
+    }
+    return game_registry_sort(gm, registry->by_type, registry->count, GAME_SORT_TYPE);
+}
+
+void game_registry_iter_init(game_registry_iter_t* iter, int type, uint8_t flags) {
+    iter->next = 0;
+    iter->type = type;
+    iter->flags = flags;
+}
+
+// Returns the next matching row index, or -1 at the end
+int game_registry_iter_next(const game_registry_snapshot_t* snapshot, game_registry_iter_t* iter) {
+    const game_registry_t* registry = &snapshot->registry;
+    while (iter->next < registry->count) {
+        uint32_t index = iter->next++;
+        if ((registry->flags[index] & iter->flags) == iter->flags &&
+            (iter->type < 0 || registry->types[index] == (uint8_t)iter->type)) {
+            return (int)index;
+        }
+    }
+    return -1;
+}
+
+// Collects the indexes of rows of the given type (any type when negative)
+// that have all of flags set, scanning only the hot columns
+uint32_t game_registry_select(const game_registry_snapshot_t* snapshot, int type, uint8_t flags,
+                              uint32_t* ids, uint32_t max_ids) {
+    const game_registry_t* registry = &snapshot->registry;
+    uint32_t found = 0;
+    
+    for (uint32_t i = 0; i < registry->count && found < max_ids; i++) {
+        if ((registry->flags[i] & flags) == flags && (type < 0 || registry->types[i] == (uint8_t)type)) {
+            ids[found++] = i;
+        }
+    }
+    return found;
+}
+
+// Sorts row indexes by a hot column with a stable LSD radix sort over
+// packed (key, index) pairs, ascending except for GAME_SORT_LAST_PLAYED
+int game_registry_sort(game_manager_t* gm, uint32_t* ids, uint32_t count, game_sort_key_t key) {
+    game_registry_t* registry = &gm->registry;
+    if (count < 2) {
+        return 0;
+    }
+    
+    uint64_t* keys = (uint64_t*)game_mem_alloc(gm, count * sizeof(uint64_t) * 2);
+    if (!keys) {
+        return -1;
+    }
+    uint64_t* scratch = keys + count;
+    
+    uint32_t passes = key == GAME_SORT_TYPE ? 1 : 4;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t id = ids[i];
+        uint32_t value;
+        if (id >= registry->count) {
+            game_mem_free(gm, keys);
+            return -1;
+        }
+        if (key == GAME_SORT_SIZE) {
+            value = registry->sizes[id];
+        } else if (key == GAME_SORT_LAST_PLAYED) {
+            value = ~registry->last_played[id];
+        } else {
+            value = registry->types[id];
+        }
+        keys[i] = ((uint64_t)value << 32) | id;
+    }
+    
+    for (uint32_t pass = 0; pass < passes; pass++) {
+        uint32_t shift = 32 + pass * 8;
+        uint32_t offsets[256];
+        memset(offsets, 0, sizeof(offsets));
+        for (uint32_t i = 0; i < count; i++) {
+            offsets[(keys[i] >> shift) & 0xFF]++;
+        }
+        
+        uint32_t total = 0;
+        for (uint32_t b = 0; b < 256; b++) {
+            uint32_t bucket = offsets[b];
+            offsets[b] = total;
+            total += bucket;
+        }
+        
+        for (uint32_t i = 0; i < count; i++) {
+            scratch[offsets[(keys[i] >> shift) & 0xFF]++] = keys[i];
+        }
+        uint64_t* swap = keys;
+        keys = scratch;
+        scratch = swap;
+    }
+    
+    for (uint32_t i = 0; i < count; i++) {
+        ids[i] = (uint32_t)keys[i];
+    }
+    
+    // An even number of passes leaves the sorted keys in the allocation
+    game_mem_free(gm, passes % 2 == 0 ? keys : scratch);
+    return 0;
+}
+
+// FNV-1a over the name, optionally folding ASCII case
+uint32_t game_name_hash(const char* name, bool fold) {
+    uint32_t hash = 2166136261u;
+    for (const uint8_t* c = (const uint8_t*)name; *c; c++) {
+        uint8_t value = *c;
+        if (fold && value >= 'A' && value <= 'Z') {
+            value += 'a' - 'A';
+        }
+        hash = (hash ^ value) * 16777619u;
+    }
+    return hash;
+}
+
+void game_index_insert(game_index_slot_t* slots, uint32_t mask, uint32_t hash, uint32_t entry) {
+    uint32_t i = hash & mask;
+    while (slots[i].entry) {
+        i = (i + 1) & mask;
+    }
+    slots[i].hash = hash;
+    slots[i].entry = entry;
+}
+
+// Linear probing without tombstones: later slots of the cluster are
+// shifted back over the hole so lookups never stop short
+void game_index_remove(game_index_slot_t* slots, uint32_t mask, uint32_t hash, uint32_t entry) {
+    uint32_t hole = hash & mask;
+    while (slots[hole].entry != entry) {
+        if (!slots[hole].entry) {
+            return;
+        }
+        hole = (hole + 1) & mask;
+    }
+    
+    for (uint32_t i = (hole + 1) & mask; slots[i].entry; i = (i + 1) & mask) {
+        uint32_t home = slots[i].hash & mask;
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            slots[hole] = slots[i];
+            hole = i;
+        }
+    }
+    slots[hole].entry = 0;
+}
+
+int validate_game_header(game_header_t* header) {
+    if (header->signature != GAME_SIGNATURE) {
+        printf("Invalid game signature\n");
+        return -1;
+    }
+    
+    if (header->version == 0) {
+        printf("Invalid game version\n");
+        return -1;
+    }
+    
+    if (header->code_size == 0 && header->data_size == 0) {
+        printf("Game has no code or data\n");
+        return -1;
+    }
+    
+    return 0;
+}
+
+void update_play_time(game_manager_t* gm) {
+    if (gm->current_game) {
+        uint32_t current_time = time(NULL);
+        gm->current_game->play_time = current_time - gm->current_game->start_time;
+    }
+}
+
+// Demo game implementations
+int demo_game_pong(game_manager_t* gm, void* game_data) {
+    printf("=== PONG ===\n");
+    printf("Classic Pong game simulation\n");
+    printf("Player 1: 5 | Player 2: 3\n");
+    printf("Game Over - Player 1 Wins!\n");
+    
+    // Simulate game running for a bit
+    for (int i = 0; i < 1000000; i++) {
+        // Simulate game logic
+        if (i % 100000 == 0) {
+            printf("Game frame %d\n", i / 100000);
+        }
+    }
+    
+    gm->current_game->current_score = 5;
+    gm->current_game->current_level = 1;
+    
+    return 0;
+}
+
+int demo_game_tetris(game_manager_t* gm, void* game_data) {
+    printf("=== TETRIS ===\n");
+    printf("Block puzzle game simulation\n");
+    printf("Lines cleared: 15\n");
+    printf("Level: 3\n");
+    printf("Score: 12450\n");
+    
+    // Simulate game running
+    for (int i = 0; i < 1500000; i++) {
+        if (i % 150000 == 0) {
+            printf("Piece %d placed\n", i / 150000);
+        }
+    }
+    
+    gm->current_game->current_score = 12450;
+    gm->current_game->current_level = 3;
+    
+    return 0;
+}
+
+int demo_game_snake(game_manager_t* gm, void* game_data) {
+    printf("=== SNAKE ===\n");
+    printf("Snake game simulation\n");
+    printf("Length: 8\n");
+    printf("Score: 80\n");
+    printf("Game Over - Snake hit wall!\n");
+    
+    // Simulate game running
+    for (int i = 0; i < 800000; i++) {
+        if (i % 100000 == 0) {
+            printf("Snake length: %d\n", 3 + i / 100000);
+        }
+    }
+    
+    gm->current_game->current_score = 80;
+    gm->current_game->current_level = 1;
+    
+    return 0;
+}
+
+int game_list_installed(game_manager_t* gm, game_registry_entry_t* games, int max_games) {
+    game_registry_snapshot_t* snapshot = game_registry_acquire(gm);
+    const game_registry_t* registry = &snapshot->registry;
+    int count = 0;
+    for (uint32_t i = 0; i < registry->count && count < max_games; i++) {
+        if (registry->flags[i] & GAME_ENTRY_INSTALLED) {
+            game_registry_row(registry, i, &games[count++]);
+        }
+    }
+    game_registry_release(gm, snapshot);
+    return count;
+}
+
+// Makes room for one more element in an array allocated with game_mem_alloc
+static int game_grow_array(game_manager_t* gm, void** array, uint32_t* capacity, uint32_t count, uint32_t size) {
+    if (count < *capacity) {
+        return 0;
+    }
+    
+    uint32_t grown = *capacity ? *capacity * 2 : 16;
+    void* resized = game_mem_alloc(gm, grown * size);
+    if (!resized) {
+        return -1;
+    }
+    if (*array) {
+        memcpy(resized, *array, count * size);
+        game_mem_free(gm, *array);
+    }
+    *array = resized;
+    *capacity = grown;
+    return 0;
+}
+
+static bool game_is_package_name(const char* name) {
+    size_t length = strlen(name);
+    return length > 5 && strcmp(name + length - 5, ".game") == 0;
+}
+
+static void game_scan_directory_task(void* arg) {
+    game_scan_task_t* task = (game_scan_task_t*)arg;
+    char host_path[MAX_PATH];
+    DIR* dir = NULL;
+    
+    if (game_host_path(task->gm, task->path, host_path, sizeof(host_path)) == 0) {
+        dir = opendir(host_path);
+    }
+    if (!dir) {
+        game_group_done(task->group);
+        return;
+    }
+    
+    struct dirent* item;
+    while ((item = readdir(dir)) != NULL) {
+        // Dot entries, the install staging directory among them, are
+        // skipped just as the watcher skips them
+        if (item->d_name[0] == '.' ||
+            (item->d_type != DT_DIR && item->d_type != DT_UNKNOWN && !game_is_package_name(item->d_name))) {
+            continue;
+        }
+        
+        char path[MAX_PATH];
+        int length = snprintf(path, sizeof(path), "%s/%s", task->path, item->d_name);
+        if (length < 0 || (size_t)length >= sizeof(path)) {
+            continue;
+        }
+        
+        struct stat st;
+        if (fstatat(dirfd(dir), item->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+            continue;
+        }
+        
+        if (S_ISDIR(st.st_mode)) {
+            if (game_grow_array(task->gm, (void**)&task->dirs, &task->dir_capacity,
+                                task->dir_count, MAX_PATH) == 0) {
+                strcpy(task->dirs[task->dir_count++], path);
+            }
+        } else if (S_ISREG(st.st_mode) && game_is_package_name(item->d_name) &&
+                   st.st_size <= (off_t)0xFFFFFFFFu) {
+            if (game_grow_array(task->gm, (void**)&task->files, &task->file_capacity,
+                                task->file_count, sizeof(game_scan_file_t)) == 0) {
+                game_scan_file_t* file = &task->files[task->file_count++];
+                strcpy(file->path, path);
+                file->size = (uint32_t)st.st_size;
+                file->mtime = (uint64_t)st.st_mtim.tv_sec * 1000000000ull + (uint64_t)st.st_mtim.tv_nsec;
+            }
+        }
+    }
+    
+    closedir(dir);
+    game_group_done(task->group);
+}
+
+// Drops a scan cache entry and the registry row it produced. Called with
+// the scan cache locked, inside a registry write batch.
+static void game_scan_drop(game_manager_t* gm, uint32_t index) {
+    game_scan_entry_t* entry = &gm->scan_cache.entries[index];
+    int row = entry->name[0] ? game_registry_find(&gm->registry, entry->name, false) : -1;
+    if (row >= 0 && strcmp(game_registry_string(&gm->registry, gm->registry.paths[row]), entry->path) == 0) {
+        game_registry_remove(gm, (uint32_t)row);
+    }
+    game_cache_invalidate(gm, entry->path);
+    game_scan_forget(gm, index);
+}
+
+// Brings the registry up to date with package files seen on disk. Only
+// files whose size or modification time changed have their headers
+// probed. Packages named in gone are dropped, as are packages under
+// directory that were not seen in this generation. All registry changes
+// land in one batch. Called with the scan cache locked.
+static int game_scan_apply(game_manager_t* gm, game_scan_file_t* files, uint32_t file_count, uint32_t generation,
+                           const char* directory, const char* const* gone, uint32_t gone_count,
+                           uint32_t* changed_count, uint32_t* registered) {
+    game_scan_cache_t* cache = &gm->scan_cache;
+    const char** changed = NULL;
+    uint32_t* changed_files = NULL;
+    game_probe_result_t* results = NULL;
+    size_t prefix = directory ? strlen(directory) : 0;
+    bool writing = false;
+    int result = -1;
+    
+    *changed_count = 0;
+    *registered = 0;
+    
+    // Unchanged packages keep their registration
+    if (file_count > 0) {
+        changed = (const char**)game_mem_alloc(gm, file_count * sizeof(const char*));
+        changed_files = (uint32_t*)game_mem_alloc(gm, file_count * sizeof(uint32_t));
+        if (!changed || !changed_files) {
+            goto cleanup;
+        }
+    }
+    
+    for (uint32_t i = 0; i < file_count; i++) {
+        int index = game_scan_lookup(gm, files[i].path);
+        if (index >= 0) {
+            game_scan_entry_t* entry = &cache->entries[index];
+            if (entry->size == files[i].size && entry->mtime == files[i].mtime) {
+                entry->generation = generation;
+                *registered += entry->name[0] != '\0';
+                continue;
+            }
+        }
+        changed[*changed_count] = files[i].path;
+        changed_files[(*changed_count)++] = i;
+    }
+    
+    if (*changed_count > 0) {
+        results = (game_probe_result_t*)game_mem_alloc(gm, *changed_count * sizeof(game_probe_result_t));
+        if (!results || game_probe_headers(gm, changed, *changed_count, results) < 0) {
+            goto cleanup;
+        }
+    }
+    
+    // Readers see the registry before or after the whole scan
+    game_registry_write_begin(gm);
+    writing = true;
+    if (*changed_count > 0 && game_registry_reserve(gm, gm->registry.count + *changed_count) != 0) {
+        goto cleanup;
+    }
+    
+    for (uint32_t i = 0; i < *changed_count; i++) {
+        game_scan_file_t* file = &files[changed_files[i]];
+        game_probe_result_t* probe = &results[i];
+        
+        int index = game_scan_lookup(gm, file->path);
+        if (index >= 0) {
+            // The package was rewritten, so drop its old registration
+            game_scan_entry_t* entry = &cache->entries[index];
+            int row = entry->name[0] ? game_registry_find(&gm->registry, entry->name, false) : -1;
+            if (row >= 0 && strcmp(game_registry_string(&gm->registry, gm->registry.paths[row]), file->path) == 0) {
+                game_registry_remove(gm, (uint32_t)row);
+            }
+            game_cache_invalidate(gm, file->path);
+        } else {
+            index = game_scan_remember(gm, file->path);
+            if (index < 0) {
+                goto cleanup;
+            }
+        }
+        
+        game_scan_entry_t* entry = &cache->entries[index];
+        entry->size = file->size;
+        entry->mtime = file->mtime;
+        entry->checksum = probe->checksum;
+        entry->generation = generation;
+        entry->name[0] = '\0';
+        
+        if (probe->status != GAME_PROBE_OK) {
+            printf("Skipping invalid package: %s\n", file->path);
+            continue;
+        }
+        // A row for this path may come from the catalog of an earlier run
+        int existing = game_registry_find(&gm->registry, probe->name, false);
+        if (existing >= 0 &&
+            strcmp(game_registry_string(&gm->registry, gm->registry.paths[existing]), file->path) != 0) {
+            printf("Duplicate game name '%s': %s\n", probe->name, file->path);
+            continue;
+        }
+        if (existing >= 0) {
+            game_registry_remove(gm, (uint32_t)existing);
+        }
+        
+        game_registry_entry_t row;
+        memset(&row, 0, sizeof(row));
+        strcpy(row.name, probe->name);
+        strcpy(row.author, probe->author);
+        strcpy(row.path, file->path);
+        row.type = probe->type;
+        row.size = file->size;
+        row.checksum = probe->checksum;
+        row.is_installed = true;
+        if (game_registry_add(gm, &row) >= 0) {
+            strcpy(entry->name, probe->name);
+            (*registered)++;
+        }
+    }
+    
+    // Forget packages that are gone
+    for (uint32_t i = 0; i < gone_count; i++) {
+        int index = game_scan_lookup(gm, gone[i]);
+        if (index >= 0) {
+            game_scan_drop(gm, (uint32_t)index);
+        }
+    }
+    for (uint32_t i = cache->count; directory && i-- > 0;) {
+        game_scan_entry_t* entry = &cache->entries[i];
+        if (entry->generation != generation && strncmp(entry->path, directory, prefix) == 0 &&
+            entry->path[prefix] == '/') {
+            game_scan_drop(gm, i);
+        }
+    }
+    result = 0;
+    
+cleanup:
+    if (writing && game_registry_write_end(gm) != 0) {
+        result = -1;
+    }
+    if (changed) game_mem_free(gm, changed);
+    if (changed_files) game_mem_free(gm, changed_files);
+    if (results) game_mem_free(gm, results);
+    return result;
+}
+
+// Registers the packages under directory. Each level of the tree is
+// listed in parallel on the worker pool, then only files whose size or
+// modification time changed since the last scan have their headers
+// probed, and the registry is updated in one batch. Packages that have
+// disappeared are unregistered. Needs the host file system to list
+// directories.
+int game_scan_directory(game_manager_t* gm, const char* directory) {
+    printf("Scanning directory: %s\n", directory);
+    
+    if (gm->host_root[0] == '\0') {
+        return 0;
+    }
+    
+    game_scan_cache_t* cache = &gm->scan_cache;
+    pthread_mutex_lock(&cache->lock);
+    uint32_t generation = ++cache->generation;
+    
+    game_scan_file_t* files = NULL;
+    uint32_t file_count = 0;
+    uint32_t file_capacity = 0;
+    char (*level)[MAX_PATH] = NULL;
+    uint32_t level_count = 0;
+    uint32_t level_capacity = 0;
+    uint32_t changed_count = 0;
+    uint32_t registered = 0;
+    int result = -1;
+    
+    if (strlen(directory) >= MAX_PATH ||
+        game_grow_array(gm, (void**)&level, &level_capacity, 0, MAX_PATH) != 0) {
+        goto cleanup;
+    }
+    strcpy(level[0], directory);
+    level_count = 1;
+    
+    for (uint32_t depth = 0; depth <= GAME_SCAN_MAX_DEPTH && level_count > 0; depth++) {
+        game_scan_task_t* tasks = (game_scan_task_t*)game_mem_alloc(gm, level_count * sizeof(game_scan_task_t));
+        if (!tasks) {
+            goto cleanup;
+        }
+        memset(tasks, 0, level_count * sizeof(game_scan_task_t));
+        
+        game_task_group_t group;
+        game_group_init(&group);
+        for (uint32_t i = 0; i < level_count; i++) {
+            tasks[i].gm = gm;
+            strcpy(tasks[i].path, level[i]);
+            tasks[i].group = &group;
+            game_group_add(&group);
+            game_pool_submit(&gm->pool, game_scan_directory_task, &tasks[i]);
+        }
+        game_group_wait(&group);
+        game_group_destroy(&group);
+        
+        // Gather this level's packages and the next level's directories
+        bool failed = false;
+        char (*next)[MAX_PATH] = NULL;
+        uint32_t next_count = 0;
+        uint32_t next_capacity = 0;
+        for (uint32_t i = 0; i < level_count; i++) {
+            game_scan_task_t* task = &tasks[i];
+            for (uint32_t j = 0; j < task->file_count && !failed; j++) {
+                if (game_grow_array(gm, (void**)&files, &file_capacity, file_count, sizeof(game_scan_file_t)) != 0) {
+                    failed = true;
+                } else {
+                    files[file_count++] = task->files[j];
+                }
+            }
+            for (uint32_t j = 0; j < task->dir_count && !failed; j++) {
+                if (game_grow_array(gm, (void**)&next, &next_capacity, next_count, MAX_PATH) != 0) {
+                    failed = true;
+                } else {
+                    strcpy(next[next_count++], task->dirs[j]);
+                }
+            }
+            if (task->files) game_mem_free(gm, task->files);
+            if (task->dirs) game_mem_free(gm, task->dirs);
+        }
+        game_mem_free(gm, tasks);
+        game_mem_free(gm, level);
+        level = next;
+        level_count = next_count;
+        if (failed) {
+            goto cleanup;
+        }
+    }
+    
+    if (game_scan_apply(gm, files, file_count, generation, directory, NULL, 0, &changed_count, &registered) != 0) {
+        goto cleanup;
+    }
+    
+    printf("Found %d packages, %d changed, %d registered\n", file_count, changed_count, registered);
+    result = 0;
+    
+cleanup:
+    pthread_mutex_unlock(&cache->lock);
+    if (files) game_mem_free(gm, files);
+    if (level) game_mem_free(gm, level);
+    return result;
+}
+
+// Brings the registry up to date with individual package files, such as
+// the ones the watcher saw change. Paths that no longer name a package
+// file are unregistered.
+int game_scan_files(game_manager_t* gm, const char* const* paths, uint32_t count) {
+    if (gm->host_root[0] == '\0' || count == 0) {
+        return 0;
+    }
+    
+    game_scan_cache_t* cache = &gm->scan_cache;
+    pthread_mutex_lock(&cache->lock);
+    
+    game_scan_file_t* files = (game_scan_file_t*)game_mem_alloc(gm, count * sizeof(game_scan_file_t));
+    const char** gone = (const char**)game_mem_alloc(gm, count * sizeof(const char*));
+    uint32_t file_count = 0;
+    uint32_t gone_count = 0;
+    uint32_t changed_count = 0;
+    uint32_t registered = 0;
+    int result = -1;
+    
+    if (!files || !gone) {
+        goto cleanup;
+    }
+    
+    for (uint32_t i = 0; i < count; i++) {
+        char host_path[MAX_PATH];
+        struct stat st;
+        if (strlen(paths[i]) >= MAX_PATH || game_host_path(gm, paths[i], host_path, sizeof(host_path)) != 0) {
+            continue;
+        }
+        
+        if (lstat(host_path, &st) == 0 && S_ISREG(st.st_mode) && st.st_size <= (off_t)0xFFFFFFFFu) {
+            game_scan_file_t* file = &files[file_count++];
+            strcpy(file->path, paths[i]);
+            file->size = (uint32_t)st.st_size;
+            file->mtime = (uint64_t)st.st_mtim.tv_sec * 1000000000ull + (uint64_t)st.st_mtim.tv_nsec;
+        } else {
+            gone[gone_count++] = paths[i];
+        }
+    }
+    
+    if (game_scan_apply(gm, files, file_count, cache->generation, NULL, gone, gone_count,
+                        &changed_count, &registered) != 0) {
+        goto cleanup;
+    }
+    
+    printf("Updated %d packages, %d changed, %d removed\n", file_count, changed_count, gone_count);
+    result = 0;
+    
+cleanup:
+    pthread_mutex_unlock(&cache->lock);
+    if (files) game_mem_free(gm, files);
+    if (gone) game_mem_free(gm, gone);
+    return result;
+}
+
+int game_scan_lookup(game_manager_t* gm, const char* path) {
+    game_scan_cache_t* cache = &gm->scan_cache;
+    if (cache->capacity == 0) {
+        return -1;
+    }
+    
+    uint32_t hash = game_name_hash(path, false);
+    uint32_t mask = cache->capacity * 2 - 1;
+    for (uint32_t i = hash & mask; cache->index[i].entry; i = (i + 1) & mask) {
+        uint32_t index = cache->index[i].entry - 1;
+        if (cache->index[i].hash == hash && strcmp(cache->entries[index].path, path) == 0) {
+            return (int)index;
+        }
+    }
+    return -1;
+}
+
+// Adds an empty scan cache entry for path, growing the cache when full
+int game_scan_remember(game_manager_t* gm, const char* path) {
+    game_scan_cache_t* cache = &gm->scan_cache;
+    
+    if (cache->count == cache->capacity) {
+        uint32_t capacity = cache->capacity ? cache->capacity * 2 : GAME_REGISTRY_MIN_CAPACITY;
+        game_scan_entry_t* entries = (game_scan_entry_t*)game_mem_alloc(gm, capacity * sizeof(game_scan_entry_t));
+        game_index_slot_t* index = (game_index_slot_t*)game_mem_alloc(gm, capacity * 2 * sizeof(game_index_slot_t));
+        if (!entries || !index) {
+            if (entries) game_mem_free(gm, entries);
+            if (index) game_mem_free(gm, index);
+            return -1;
+        }
+        
+        memset(index, 0, capacity * 2 * sizeof(game_index_slot_t));
+        for (uint32_t i = 0; i < cache->count; i++) {
+            entries[i] = cache->entries[i];
+            game_index_insert(index, capacity * 2 - 1, game_name_hash(entries[i].path, false), i + 1);
+        }
+        if (cache->entries) game_mem_free(gm, cache->entries);
+        if (cache->index) game_mem_free(gm, cache->index);
+        cache->entries = entries;
+        cache->index = index;
+        cache->capacity = capacity;
+    }
+    
+    uint32_t slot = cache->count++;
+    game_scan_entry_t* entry = &cache->entries[slot];
+    memset(entry, 0, sizeof(game_scan_entry_t));
+    strcpy(entry->path, path);
+    game_index_insert(cache->index, cache->capacity * 2 - 1, game_name_hash(path, false), slot + 1);
+    return (int)slot;
+}
+
+// Removes an entry by moving the last entry into its place
+void game_scan_forget(game_manager_t* gm, uint32_t index) {
+    game_scan_cache_t* cache = &gm->scan_cache;
+    uint32_t mask = cache->capacity * 2 - 1;
+    uint32_t last = cache->count - 1;
+    
+    game_index_remove(cache->index, mask, game_name_hash(cache->entries[index].path, false), index + 1);
+    if (index != last) {
+        uint32_t hash = game_name_hash(cache->entries[last].path, false);
+        game_index_remove(cache->index, mask, hash, last + 1);
+        cache->entries[index] = cache->entries[last];
+        game_index_insert(cache->index, mask, hash, index + 1);
+    }
+    cache->count--;
+}
+
+void game_scan_cache_free(game_manager_t* gm) {
+    game_scan_cache_t* cache = &gm->scan_cache;
+    if (cache->entries) game_mem_free(gm, cache->entries);
+    if (cache->index) game_mem_free(gm, cache->index);
+    memset(cache, 0, sizeof(game_scan_cache_t));
+}
+
+static uint64_t game_watch_clock(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+}
+
+// Watches directory and the directories below it, skipping hidden ones
+// such as the install staging directory
+static void game_watch_add(game_manager_t* gm, const char* directory, uint32_t depth) {
+    game_watcher_t* watcher = &gm->watcher;
+    char host_path[MAX_PATH];
+    if (game_host_path(gm, directory, host_path, sizeof(host_path)) != 0) {
+        return;
+    }
+    
+    int wd = inotify_add_watch(watcher->fd, host_path,
+                               IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                               IN_DELETE_SELF | IN_ONLYDIR);
+    if (wd < 0) {
+        return;
+    }
+    
+    // A directory moved within the tree keeps its watch
+    uint32_t i = 0;
+    while (i < watcher->dir_count && watcher->dirs[i].wd != wd) {
+        i++;
+    }
+    if (i == watcher->dir_count) {
+        if (game_grow_array(gm, (void**)&watcher->dirs, &watcher->dir_capacity, watcher->dir_count,
+                            sizeof(game_watch_dir_t)) != 0) {
+            inotify_rm_watch(watcher->fd, wd);
+            return;
+        }
+        watcher->dir_count++;
+    }
+    watcher->dirs[i].wd = wd;
+    strcpy(watcher->dirs[i].path, directory);
+    
+    DIR* dir = depth < GAME_SCAN_MAX_DEPTH ? opendir(host_path) : NULL;
+    if (!dir) {
+        return;
+    }
+    
+    struct dirent* item;
+    while ((item = readdir(dir)) != NULL) {
+        if (item->d_name[0] == '.') {
+            continue;
+        }
+        
+        char path[MAX_PATH];
+        struct stat st;
+        int length = snprintf(path, sizeof(path), "%s/%s", directory, item->d_name);
+        if (length < 0 || (size_t)length >= sizeof(path) ||
+            fstatat(dirfd(dir), item->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0 || !S_ISDIR(st.st_mode)) {
+            continue;
+        }
+        game_watch_add(gm, path, depth + 1);
+    }
+    closedir(dir);
+}
+
+// Stops watching directory and the directories below it
+static void game_watch_remove(game_manager_t* gm, const char* directory) {
+    game_watcher_t* watcher = &gm->watcher;
+    size_t prefix = strlen(directory);
+    for (uint32_t i = watcher->dir_count; i-- > 0;) {
+        const char* path = watcher->dirs[i].path;
+        if (strncmp(path, directory, prefix) != 0 || (path[prefix] != '\0' && path[prefix] != '/')) {
+            continue;
+        }
+        inotify_rm_watch(watcher->fd, watcher->dirs[i].wd);
+        watcher->dirs[i] = watcher->dirs[--watcher->dir_count];
+    }
+}
+
+static const char* game_watch_dir_path(game_watcher_t* watcher, int wd) {
+    for (uint32_t i = 0; i < watcher->dir_count; i++) {
+        if (watcher->dirs[i].wd == wd) {
+            return watcher->dirs[i].path;
+        }
+    }
+    return NULL;
+}
+
+static int game_watch_compare(const void* a, const void* b) {
+    return strcmp((const char*)a, (const char*)b);
+}
+
+// Sorts pending paths and drops duplicates and paths below a pending
+// directory, which that directory's rescan covers. Without dirs, paths
+// are directories themselves and cover each other.
+static uint32_t game_watch_coalesce(char (*paths)[MAX_PATH], uint32_t count,
+                                    char (*dirs)[MAX_PATH], uint32_t dir_count) {
+    if (count == 0) {
+        return 0;
+    }
+    qsort(paths, count, MAX_PATH, game_watch_compare);
+    
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        bool covered = kept > 0 && strcmp(paths[kept - 1], paths[i]) == 0;
+        char (*parents)[MAX_PATH] = dirs ? dirs : paths;
+        uint32_t parent_count = dirs ? dir_count : kept;
+        for (uint32_t j = 0; j < parent_count && !covered; j++) {
+            size_t prefix = strlen(parents[j]);
+            covered = strncmp(paths[i], parents[j], prefix) == 0 && paths[i][prefix] == '/';
+        }
+        if (!covered && kept != i) {
+            memcpy(paths[kept], paths[i], MAX_PATH);
+        }
+        kept += !covered;
+    }
+    return kept;
+}
+
+static void* game_watch_thread(void* arg) {
+    game_manager_t* gm = (game_manager_t*)arg;
+    game_watcher_t* watcher = &gm->watcher;
+    char (*files)[MAX_PATH] = NULL;
+    char (*dirs)[MAX_PATH] = NULL;
+    uint32_t file_count = 0;
+    uint32_t file_capacity = 0;
+    uint32_t dir_count = 0;
+    uint32_t dir_capacity = 0;
+    bool rescan = false;
+    uint64_t first = 0;
+    uint64_t last = 0;
+    
+    char buffer[16384] __attribute__((aligned(__alignof__(struct inotify_event))));
+    
+    for (;;) {
+        bool pending = rescan || file_count > 0 || dir_count > 0;
+        int timeout = -1;
+        if (pending) {
+            uint64_t now = game_watch_clock();
+            uint64_t settle = last + GAME_WATCH_SETTLE_MS;
+            uint64_t deadline = first + GAME_WATCH_MAX_DELAY_MS;
+            uint64_t due = settle < deadline ? settle : deadline;
+            timeout = due > now ? (int)(due - now) : 0;
+        }
+        
+        struct pollfd fds[2];
+        fds[0].fd = watcher->wake[0];
+        fds[0].events = POLLIN;
+        fds[1].fd = watcher->fd;
+        fds[1].events = POLLIN;
+        if (poll(fds, 2, timeout) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (fds[0].revents) {
+            break;
+        }
+        
+        if (fds[1].revents & POLLIN) {
+            ssize_t length = read(watcher->fd, buffer, sizeof(buffer));
+            for (ssize_t offset = 0; offset < length;) {
+                const struct inotify_event* event = (const struct inotify_event*)(buffer + offset);
+                offset += sizeof(struct inotify_event) + event->len;
+                
+                if (event->mask & IN_Q_OVERFLOW) {
+                    // Events were lost, so only a full rescan is safe
+                    rescan = true;
+                    continue;
+                }
+                if (event->mask & IN_IGNORED) {
+                    for (uint32_t i = 0; i < watcher->dir_count; i++) {
+                        if (watcher->dirs[i].wd == event->wd) {
+                            watcher->dirs[i] = watcher->dirs[--watcher->dir_count];
+                            break;
+                        }
+                    }
+                    continue;
+                }
+                
+                const char* directory = game_watch_dir_path(watcher, event->wd);
+                if (!directory) {
+                    continue;
+                }
+                
+                char path[MAX_PATH];
+                if (event->mask & IN_DELETE_SELF) {
+                    strcpy(path, directory);
+                } else {
+                    int path_length = snprintf(path, sizeof(path), "%s/%s", directory, event->name);
+                    if (event->len == 0 || event->name[0] == '.' || path_length < 0 ||
+                        (size_t)path_length >= sizeof(path)) {
+                        continue;
+                    }
+                }
+                
+                if (event->mask & (IN_ISDIR | IN_DELETE_SELF)) {
+                    if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                        game_watch_add(gm, path, 0);
+                    } else if (event->mask & IN_MOVED_FROM) {
+                        game_watch_remove(gm, path);
+                    }
+                    if (game_grow_array(gm, (void**)&dirs, &dir_capacity, dir_count, MAX_PATH) != 0) {
+                        rescan = true;
+                    } else {
+                        strcpy(dirs[dir_count++], path);
+                    }
+                } else if (game_is_package_name(event->name)) {
+                    if (game_grow_array(gm, (void**)&files, &file_capacity, file_count, MAX_PATH) != 0) {
+                        rescan = true;
+                    } else {
+                        strcpy(files[file_count++], path);
+                    }
+                }
+                
+                last = game_watch_clock();
+                if (!pending) {
+                    first = last;
+                    pending = true;
+                }
+            }
+        }
+        
+        if (!rescan && file_count == 0 && dir_count == 0) {
+            continue;
+        }
+        uint64_t now = game_watch_clock();
+        if (now < last + GAME_WATCH_SETTLE_MS && now < first + GAME_WATCH_MAX_DELAY_MS) {
+            continue;
+        }
+        
+        // Apply the burst
+        if (rescan) {
+            game_scan_directory(gm, watcher->root);
+        } else {
+            dir_count = game_watch_coalesce(dirs, dir_count, NULL, 0);
+            file_count = game_watch_coalesce(files, file_count, dirs, dir_count);
+            for (uint32_t i = 0; i < dir_count; i++) {
+                game_scan_directory(gm, dirs[i]);
+            }
+            
+            const char** paths = file_count > 0 ?
+                (const char**)game_mem_alloc(gm, file_count * sizeof(const char*)) : NULL;
+            if (paths) {
+                for (uint32_t i = 0; i < file_count; i++) {
+                    paths[i] = files[i];
+                }
+                game_scan_files(gm, paths, file_count);
+                game_mem_free(gm, paths);
+            } else if (file_count > 0) {
+                game_scan_directory(gm, watcher->root);
+            }
+        }
+        rescan = false;
+        file_count = 0;
+        dir_count = 0;
+    }
+    
+    if (files) game_mem_free(gm, files);
+    if (dirs) game_mem_free(gm, dirs);
+    return NULL;
+}
+
+// Keeps the registry current with the packages under directory. A
+// thread follows the host directories with inotify and applies bursts of
+// changes as incremental updates, so no periodic full scans are needed.
+// Directories created later are watched as they appear.
+int game_watch_start(game_manager_t* gm, const char* directory) {
+    game_watcher_t* watcher = &gm->watcher;
+    if (gm->host_root[0] == '\0' || watcher->running || strlen(directory) >= MAX_PATH) {
+        return -1;
+    }
+    
+    memset(watcher, 0, sizeof(game_watcher_t));
+    watcher->wake[0] = -1;
+    watcher->wake[1] = -1;
+    strcpy(watcher->root, directory);
+    watcher->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watcher->fd < 0 || pipe(watcher->wake) != 0) {
+        printf("Failed to watch directory: %s\n", directory);
+        goto fail;
+    }
+    
+    game_watch_add(gm, directory, 0);
+    if (watcher->dir_count == 0) {
+        printf("Failed to watch directory: %s\n", directory);
+        goto fail;
+    }
+    
+    // Catch up with whatever changed before the watches were in place
+    game_scan_directory(gm, directory);
+    
+    if (pthread_create(&watcher->thread, NULL, game_watch_thread, gm) != 0) {
+        printf("Failed to start watcher thread\n");
+        goto fail;
+    }
+    watcher->running = true;
+    printf("Watching %d directories under %s\n", watcher->dir_count, directory);
+    return 0;
+    
+fail:
+    if (watcher->fd >= 0) close(watcher->fd);
+    if (watcher->wake[0] >= 0) close(watcher->wake[0]);
+    if (watcher->wake[1] >= 0) close(watcher->wake[1]);
+    if (watcher->dirs) game_mem_free(gm, watcher->dirs);
+    memset(watcher, 0, sizeof(game_watcher_t));
+    return -1;
+}
+
+void game_watch_stop(game_manager_t* gm) {
+    game_watcher_t* watcher = &gm->watcher;
+    if (!watcher->running) {
+        return;
+    }
+    
+    char wake = 0;
+    if (write(watcher->wake[1], &wake, 1) != 1) {
+        printf("Failed to wake watcher thread\n");
+    }
+    pthread_join(watcher->thread, NULL);
+    
+    close(watcher->fd);
+    close(watcher->wake[0]);
+    close(watcher->wake[1]);
+    if (watcher->dirs) game_mem_free(gm, watcher->dirs);
+    memset(watcher, 0, sizeof(game_watcher_t));
+}
+
+int game_install(game_manager_t* gm, const char* game_path) {
+    int result = -1;
+    game_install_bulk(gm, &game_path, 1, &result);
+    return result;
+}
+
+int game_uninstall(game_manager_t* gm, const char* game_name) {
+    int result = -1;
+    game_uninstall_bulk(gm, &game_name, 1, &result);
+    return result;
+}
+
+// Staging file for a package destined for path
+static int game_staged_path(game_manager_t* gm, const char* path, char* host_path, size_t size) {
+    char staged[MAX_PATH];
+    const char* base = strrchr(path, '/');
+    int length = snprintf(staged, sizeof(staged), GAME_STAGING_DIR "/%s.part", base ? base + 1 : path);
+    if (length < 0 || (size_t)length >= sizeof(staged)) {
+        return -1;
+    }
+    return game_host_path(gm, staged, host_path, size);
+}
+
+// Writes the journal and syncs it, after which the operation must be
+// carried through
+static int game_journal_write(game_manager_t* gm, game_journal_operation_t operation,
+                              char (*paths)[MAX_PATH], uint32_t count) {
+    char host_path[MAX_PATH];
+    if (game_host_path(gm, GAME_JOURNAL_PATH, host_path, sizeof(host_path)) != 0) {
+        return -1;
+    }
+    
+    game_journal_header_t header;
+    header.signature = JOURNAL_SIGNATURE;
+    header.operation = operation;
+    header.count = count;
+    header.checksum = calculate_checksum(paths, count * MAX_PATH);
+    
+    int fd = open(host_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    
+    size_t bytes = (size_t)count * MAX_PATH;
+    int result = -1;
+    if (write(fd, &header, sizeof(header)) == (ssize_t)sizeof(header) &&
+        write(fd, paths, bytes) == (ssize_t)bytes && fdatasync(fd) == 0) {
+        result = 0;
+    }
+    close(fd);
+    
+    if (result != 0 || game_sync_directory(gm, GAME_STAGING_DIR) != 0) {
+        unlink(host_path);
+        return -1;
+    }
+    return 0;
+}
+
+static void game_journal_remove(game_manager_t* gm) {
+    char host_path[MAX_PATH];
+    if (game_host_path(gm, GAME_JOURNAL_PATH, host_path, sizeof(host_path)) == 0) {
+        unlink(host_path);
+    }
+}
+
+// Copies a package with large sequential writes into space allocated up
+// front, then syncs its data
+static int game_install_copy(game_manager_t* gm, const char* source, const char* staged) {
+    char host_path[MAX_PATH];
+    if (game_host_path(gm, source, host_path, sizeof(host_path)) != 0) {
+        return -1;
+    }
+    
+    int in = open(host_path, O_RDONLY);
+    if (in < 0) {
+        return -1;
+    }
+    int out = open(staged, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    uint8_t* buffer = (uint8_t*)game_mem_alloc(gm, GAME_INSTALL_COPY_CHUNK);
+    struct stat st;
+    int result = -1;
+    
+    if (out >= 0 && buffer && fstat(in, &st) == 0 &&
+        (st.st_size == 0 || posix_fallocate(out, 0, st.st_size) != ENOSPC)) {
+        posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+        
+        off_t copied = 0;
+        ssize_t length;
+        while ((length = read(in, buffer, GAME_INSTALL_COPY_CHUNK)) > 0) {
+            if (write(out, buffer, (size_t)length) != length) {
+                break;
+            }
+            copied += length;
+        }
+        if (length == 0 && copied == st.st_size && fdatasync(out) == 0) {
+            result = 0;
+        }
+    }
+    
+    if (buffer) game_mem_free(gm, buffer);
+    if (out >= 0) close(out);
+    close(in);
+    return result;
+}
+
+static void game_install_copy_task(void* arg) {
+    game_install_task_t* task = (game_install_task_t*)arg;
+    task->status = game_install_copy(task->gm, task->source, task->staged);
+    game_group_done(task->group);
+}
+
+// Copies a package through the file system API, for installs without a
+// host root. There is no staging there, so these installs are not atomic.
+static int game_install_copy_fs(game_manager_t* gm, const char* source, const char* target) {
+    file_handle_t* in = game_fs_open(gm, source, 0x01);
+    if (!in) {
+        return -1;
+    }
+    file_handle_t* out = game_fs_open(gm, target, 0x02);
+    uint8_t* buffer = (uint8_t*)game_mem_alloc(gm, GAME_INSTALL_COPY_CHUNK);
+    int result = out && buffer ? 0 : -1;
+    
+    uint32_t length;
+    while (result == 0 && (length = game_fs_read(gm, in, buffer, GAME_INSTALL_COPY_CHUNK)) > 0) {
+        if (game_fs_write(gm, out, buffer, length) != length) {
+            result = -1;
+        }
+    }
+    
+    if (buffer) game_mem_free(gm, buffer);
+    if (out) game_fs_close(gm, out);
+    game_fs_close(gm, in);
+    return result;
+}
+
+// Records an installed package in the scan cache so the next scan finds
+// it unchanged. Called with the scan cache locked.
+static void game_install_remember(game_manager_t* gm, const char* path, const game_probe_result_t* probe) {
+    char host_path[MAX_PATH];
+    struct stat st;
+    if (game_host_path(gm, path, host_path, sizeof(host_path)) != 0 || stat(host_path, &st) != 0) {
+        return;
+    }
+    
+    int index = game_scan_lookup(gm, path);
+    if (index < 0 && (index = game_scan_remember(gm, path)) < 0) {
+        return;
+    }
+    game_scan_entry_t* entry = &gm->scan_cache.entries[index];
+    entry->size = (uint32_t)st.st_size;
+    entry->mtime = (uint64_t)st.st_mtim.tv_sec * 1000000000ull + (uint64_t)st.st_mtim.tv_nsec;
+    entry->checksum = probe->checksum;
+    entry->generation = gm->scan_cache.generation;
+    strcpy(entry->name, probe->name);
+}
+
+// Locks the scan cache, opens a registry batch and makes room for every
+// accepted package, so the install cannot fail with rows half applied.
+// Returns -1, with the batch still open, when the registry cannot grow.
+static int game_install_begin(game_manager_t* gm, const game_probe_result_t* probes,
+                              char (*targets)[MAX_PATH], const int* results, uint32_t count) {
+    uint32_t accepted = 0;
+    size_t bytes = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (results[i] == 0) {
+            accepted++;
+            bytes += strlen(probes[i].name) + strlen(probes[i].author) + strlen(targets[i]) + 3;
+        }
+    }
+    
+    pthread_mutex_lock(&gm->scan_cache.lock);
+    game_registry_write_begin(gm);
+    game_registry_t* registry = &gm->registry;
+    if ((registry->count + accepted > registry->capacity ||
+         !game_registry_string_room(registry, bytes, accepted * 3)) &&
+        game_registry_rebuild(gm, registry->count + accepted, bytes) != 0) {
+        printf("Failed to grow game registry\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Installs packages, given by file system path, into /games as one
+// transaction. Headers are validated in parallel; invalid or conflicting
+// packages are rejected in results (0 installed, -1 not) without holding
+// up the rest. Accepted packages are copied into the staging directory on
+// the pool and synced, then a journal is written and they are renamed into
+// place with a single directory sync; a package whose rename fails is
+// dropped. The registry makes room for all of them before the journal and
+// takes them in one batch. Returns how many were installed, or -1 when the transaction
+// failed and nothing was installed. -1 is also returned, with results
+// kept, when the batch could not be published; readers then see the games
+// once a later batch publishes.
+int game_install_bulk(game_manager_t* gm, const char* const* paths, uint32_t count, int* results) {
+    game_probe_result_t* probes = NULL;
+    game_install_task_t* tasks = NULL;
+    char (*targets)[MAX_PATH] = NULL;
+    char (*journal)[MAX_PATH] = NULL;
+    uint32_t journal_count = 0;
+    bool staged = gm->host_root[0] != '\0';
+    int installed = 0;
+    int result = -1;
+    bool writing = false;
+    bool published = true;
+    
+    for (uint32_t i = 0; i < count; i++) {
+        results[i] = -1;
+    }
+    if (count == 0) {
+        return 0;
+    }
+    
+    probes = (game_probe_result_t*)game_mem_alloc(gm, count * sizeof(game_probe_result_t));
+    tasks = (game_install_task_t*)game_mem_alloc(gm, count * sizeof(game_install_task_t));
+    targets = (char (*)[MAX_PATH])game_mem_alloc(gm, count * MAX_PATH);
+    journal = (char (*)[MAX_PATH])game_mem_alloc(gm, count * MAX_PATH);
+    if (!probes || !tasks || !targets || !journal || game_probe_headers(gm, paths, count, probes) < 0) {
+        goto cleanup;
+    }
+    memset(tasks, 0, count * sizeof(game_install_task_t));
+    memset(journal, 0, count * MAX_PATH);
+    
+    for (uint32_t i = 0; i < count; i++) {
+        const char* base = strrchr(paths[i], '/');
+        base = base ? base + 1 : paths[i];
+        int length = snprintf(targets[i], MAX_PATH, "/games/%s", base);
+        
+        if (probes[i].status != GAME_PROBE_OK || !game_is_package_name(base) ||
+            length < 0 || length >= MAX_PATH) {
+            printf("Rejecting invalid package: %s\n", paths[i]);
+            continue;
+        }
+        
+        bool duplicate = false;
+        for (uint32_t j = 0; j < i && !duplicate; j++) {
+            duplicate = results[j] == 0 &&
+                        (strcmp(probes[j].name, probes[i].name) == 0 || strcmp(targets[j], targets[i]) == 0);
+        }
+        
+        // Reinstalling over the same package replaces it
+        game_registry_entry_t existing;
+        if (duplicate || (game_registry_lookup(gm, probes[i].name, &existing) >= 0 &&
+                          strcmp(existing.path, targets[i]) != 0)) {
+            printf("Duplicate game name '%s': %s\n", probes[i].name, paths[i]);
+            continue;
+        }
+        results[i] = 0;
+    }
+    
+    if (staged) {
+        char host_path[MAX_PATH];
+        if (game_host_path(gm, GAME_STAGING_DIR, host_path, sizeof(host_path)) != 0 ||
+            (mkdir(host_path, 0755) != 0 && errno != EEXIST)) {
+            goto cleanup;
+        }
+        
+        game_task_group_t group;
+        game_group_init(&group);
+        for (uint32_t i = 0; i < count; i++) {
+            game_install_task_t* task = &tasks[i];
+            if (results[i] != 0 || strcmp(paths[i], targets[i]) == 0) {
+                continue;
+            }
+            
+            task->gm = gm;
+            task->source = paths[i];
+            task->group = &group;
+            if (game_staged_path(gm, targets[i], task->staged, sizeof(task->staged)) != 0) {
+                task->status = -1;
+                continue;
+            }
+            strcpy(journal[journal_count++], targets[i]);
+            game_group_add(&group);
+            game_pool_submit(&gm->pool, game_install_copy_task, task);
+        }
+        game_group_wait(&group);
+        game_group_destroy(&group);
+        
+        bool ready = true;
+        for (uint32_t i = 0; i < count; i++) {
+            ready = ready && tasks[i].status == 0;
+        }
+        if (ready) {
+            writing = true;
+            ready = game_install_begin(gm, probes, targets, results, count) == 0;
+        }
+        if (!ready || (journal_count > 0 && game_journal_write(gm, GAME_JOURNAL_INSTALL, journal, journal_count) != 0)) {
+            printf("Failed to stage packages, nothing installed\n");
+            for (uint32_t i = 0; i < count; i++) {
+                if (tasks[i].staged[0]) {
+                    unlink(tasks[i].staged);
+                }
+            }
+            goto cleanup;
+        }
+        
+        // Past the journal, everything staged gets installed
+        for (uint32_t i = 0; i < count; i++) {
+            if (tasks[i].staged[0] &&
+                (game_host_path(gm, targets[i], host_path, sizeof(host_path)) != 0 ||
+                 rename(tasks[i].staged, host_path) != 0)) {
+                printf("Failed to install package: %s\n", paths[i]);
+                unlink(tasks[i].staged);
+                results[i] = -1;
+            }
+        }
+        if (journal_count > 0) {
+            game_sync_directory(gm, "/games");
+            game_journal_remove(gm);
+        }
+    } else {
+        writing = true;
+        if (game_install_begin(gm, probes, targets, results, count) != 0) {
+            goto cleanup;
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            if (results[i] == 0 && strcmp(paths[i], targets[i]) != 0 &&
+                game_install_copy_fs(gm, paths[i], targets[i]) != 0) {
+                printf("Failed to copy package: %s\n", paths[i]);
+                results[i] = -1;
+            }
+        }
+    }
+    
+    for (uint32_t i = 0; i < count; i++) {
+        if (results[i] == 0) {
+            game_cache_invalidate(gm, targets[i]);
+        }
+    }
+    
+    for (uint32_t i = 0; i < count; i++) {
+        game_probe_result_t* probe = &probes[i];
+        if (results[i] != 0) {
+            continue;
+        }
+        
+        int existing = game_registry_find(&gm->registry, probe->name, false);
+        if (existing >= 0) {
+            game_registry_remove(gm, (uint32_t)existing);
+        }
+        
+        game_registry_entry_t row;
+        memset(&row, 0, sizeof(row));
+        strcpy(row.name, probe->name);
+        strcpy(row.author, probe->author);
+        strcpy(row.path, targets[i]);
+        row.type = probe->type;
+        row.size = probe->file_size;
+        row.checksum = probe->checksum;
+        row.is_installed = true;
+        if (game_registry_add(gm, &row) < 0) {
+            results[i] = -1;
+            continue;
+        }
+        game_install_remember(gm, targets[i], probe);
+        installed++;
+    }
+    
+    printf("Installed %d of %d packages\n", installed, count);
+    result = installed;
+    
+cleanup:
+    if (writing) {
+        published = game_registry_write_end(gm) == 0;
+        pthread_mutex_unlock(&gm->scan_cache.lock);
+    }
+    if (result < 0) {
+        for (uint32_t i = 0; i < count; i++) {
+            results[i] = -1;
+        }
+    }
+    if (probes) game_mem_free(gm, probes);
+    if (tasks) game_mem_free(gm, tasks);
+    if (targets) game_mem_free(gm, targets);
+    if (journal) game_mem_free(gm, journal);
+    return published ? result : -1;
+}
+
+// Uninstalls games by name as one transaction: the journal names their
+// packages, the registry drops them in one batch, and the files are
+// deleted with a single directory sync. Built-in games and the running
+// game are refused. Without a host root only the rows are removed.
+// Returns how many were uninstalled, or -1, with results kept, when the
+// batch could not be published.
+int game_uninstall_bulk(game_manager_t* gm, const char* const* names, uint32_t count, int* results) {
+    bool staged = gm->host_root[0] != '\0';
+    char (*journal)[MAX_PATH] = NULL;
+    uint32_t journal_count = 0;
+    
+    for (uint32_t i = 0; i < count; i++) {
+        results[i] = -1;
+    }
+    if (count == 0) {
+        return 0;
+    }
+    
+    journal = (char (*)[MAX_PATH])game_mem_alloc(gm, count * MAX_PATH);
+    if (!journal) {
+        return -1;
+    }
+    memset(journal, 0, count * MAX_PATH);
+    
+    pthread_mutex_lock(&gm->scan_cache.lock);
+    game_registry_write_begin(gm);
+    
+    for (uint32_t i = 0; i < count; i++) {
+        int index = game_registry_find(&gm->registry, names[i], false);
+        if (index < 0) {
+            printf("Game '%s' not found\n", names[i]);
+            continue;
+        }
+        
+        const char* path = game_registry_string(&gm->registry, gm->registry.paths[index]);
+        if (strncmp(path, "builtin://", 10) == 0 ||
+            (gm->current_game && strcmp(gm->current_game->header.name, names[i]) == 0)) {
+            printf("Cannot uninstall '%s'\n", names[i]);
+            continue;
+        }
+        
+        bool listed = false;
+        for (uint32_t j = 0; j < journal_count && !listed; j++) {
+            listed = strcmp(journal[j], path) == 0;
+        }
+        if (!listed) {
+            strcpy(journal[journal_count++], path);
+        }
+        results[i] = 0;
+    }
+    
+    if (staged && journal_count > 0) {
+        char host_path[MAX_PATH];
+        if (game_host_path(gm, GAME_STAGING_DIR, host_path, sizeof(host_path)) != 0 ||
+            (mkdir(host_path, 0755) != 0 && errno != EEXIST) ||
+            game_journal_write(gm, GAME_JOURNAL_UNINSTALL, journal, journal_count) != 0) {
+            printf("Failed to write install journal, nothing uninstalled\n");
+            for (uint32_t i = 0; i < count; i++) {
+                results[i] = -1;
+            }
+            journal_count = 0;
+        }
+    }
+    
+    int removed = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        int index = results[i] == 0 ? game_registry_find(&gm->registry, names[i], false) : -1;
+        if (index < 0) {
+            continue;
+        }
+        
+        int scanned = game_scan_lookup(gm, game_registry_string(&gm->registry, gm->registry.paths[index]));
+        if (scanned >= 0) {
+            game_scan_forget(gm, (uint32_t)scanned);
+        }
+        game_registry_remove(gm, (uint32_t)index);
+        removed++;
+    }
+    
+    bool published = game_registry_write_end(gm) == 0;
+    pthread_mutex_unlock(&gm->scan_cache.lock);
+    
+    for (uint32_t i = 0; i < journal_count; i++) {
+        char host_path[MAX_PATH];
+        game_cache_invalidate(gm, journal[i]);
+        if (staged && game_host_path(gm, journal[i], host_path, sizeof(host_path)) == 0) {
+            unlink(host_path);
+        }
+    }
+    if (staged && journal_count > 0) {
+        game_sync_directory(gm, "/games");
+        game_journal_remove(gm);
+    }
+    
+    game_mem_free(gm, journal);
+    return published ? removed : -1;
+}
+
+// Finishes an install or uninstall that was cut short, then clears the
+// staging directory. Called once a host root is set.
+int game_install_recover(game_manager_t* gm) {
+    char host_path[MAX_PATH];
+    if (game_host_path(gm, GAME_JOURNAL_PATH, host_path, sizeof(host_path)) != 0) {
+        return -1;
+    }
+    
+    int fd = open(host_path, O_RDONLY);
+    if (fd >= 0) {
+        game_journal_header_t header;
+        char (*paths)[MAX_PATH] = NULL;
+        size_t bytes = 0;
+        
+        if (read(fd, &header, sizeof(header)) == (ssize_t)sizeof(header) &&
+            header.signature == JOURNAL_SIGNATURE && header.count > 0 && header.count <= 0xFFFFFFFFu / MAX_PATH) {
+            bytes = (size_t)header.count * MAX_PATH;
+            paths = (char (*)[MAX_PATH])game_mem_alloc(gm, (uint32_t)bytes);
+        }
+        if (paths && (read(fd, paths, bytes) != (ssize_t)bytes ||
+                      calculate_checksum(paths, (uint32_t)bytes) != header.checksum)) {
+            game_mem_free(gm, paths);
+            paths = NULL;
+        }
+        close(fd);
+        
+        if (paths) {
+            printf("Completing interrupted %s of %d packages\n",
+                   header.operation == GAME_JOURNAL_INSTALL ? "install" : "uninstall", header.count);
+            
+            game_registry_write_begin(gm);
+            for (uint32_t i = 0; i < header.count; i++) {
+                char target[MAX_PATH];
+                char staged[MAX_PATH];
+                paths[i][MAX_PATH - 1] = '\0';
+                if (game_host_path(gm, paths[i], target, sizeof(target)) != 0) {
+                    continue;
+                }
+                
+                if (header.operation == GAME_JOURNAL_INSTALL) {
+                    if (game_staged_path(gm, paths[i], staged, sizeof(staged)) == 0) {
+                        rename(staged, target);
+                    }
+                    continue;
+                }
+                
+                unlink(target);
+                uint32_t id = game_registry_string_find(&gm->registry, paths[i], game_name_hash(paths[i], false));
+                for (uint32_t row = 0; id != 0 && row < gm->registry.count; row++) {
+                    if (gm->registry.paths[row] == id) {
+                        game_registry_remove(gm, row);
+                        break;
+                    }
+                }
+            }
+            game_registry_write_end(gm);
+            game_sync_directory(gm, "/games");
+            game_mem_free(gm, paths);
+        }
+    }
     
-    // Simulate game running
-    for (int i = 0; i < 800000; i++) {
-        if (i % 100000 == 0) {
-            printf("Snake length: %d\n", 3 + i / 100000);
+    // Anything left in staging belongs to an install that never committed
+    if (game_host_path(gm, GAME_STAGING_DIR, host_path, sizeof(host_path)) != 0) {
+        return -1;
+    }
+    DIR* dir = opendir(host_path);
+    if (dir) {
+        struct dirent* item;
+        while ((item = readdir(dir)) != NULL) {
+            if (item->d_name[0] != '.') {
+                unlinkat(dirfd(dir), item->d_name, 0);
+            }
         }
+        closedir(dir);
+    }
+    return 0;
+}
+
+static uint8_t game_search_fold(uint8_t c) {
+    return c >= 'A' && c <= 'Z' ? (uint8_t)(c + 'a' - 'A') : c;
+}
+
+// Letters, digits and any non-ASCII byte make up words
+static bool game_search_is_word(uint8_t c) {
+    return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c >= 0x80;
+}
+
+static uint32_t game_search_fold_text(const char* text, char* folded, uint32_t size) {
+    uint32_t length = 0;
+    while (text[length] && length < size - 1) {
+        folded[length] = (char)game_search_fold((uint8_t)text[length]);
+        length++;
+    }
+    folded[length] = '\0';
+    return length;
+}
+
+static const game_search_postings_t* game_search_lookup(const game_search_t* search, uint32_t key) {
+    if (!search->table) {
+        return NULL;
     }
     
-    gm->current_game->current_score = 80;
-    gm->current_game->current_level = 1;
+    uint32_t mask = search->table_capacity - 1;
+    for (uint32_t i = (key * 2654435761u) & mask; search->table[i].key; i = (i + 1) & mask) {
+        if (search->table[i].key == key) {
+            return &search->table[i];
+        }
+    }
+    return NULL;
+}
+
+// Appends a document to a key's postings. Documents are indexed one at a
+// time in increasing order, so a repeated key is always the last entry.
+static int game_search_post(game_manager_t* gm, uint32_t key, uint32_t doc) {
+    game_search_t* search = &gm->search;
+    if ((search->key_count + 1) * 2 > search->table_capacity) {
+        uint32_t capacity = search->table_capacity ? search->table_capacity * 2 : 1024;
+        game_search_postings_t* table =
+            (game_search_postings_t*)game_mem_alloc(gm, capacity * sizeof(game_search_postings_t));
+        if (!table) {
+            return -1;
+        }
+        memset(table, 0, capacity * sizeof(game_search_postings_t));
+        
+        for (uint32_t i = 0; i < search->table_capacity; i++) {
+            if (search->table[i].key) {
+                uint32_t slot = (search->table[i].key * 2654435761u) & (capacity - 1);
+                while (table[slot].key) {
+                    slot = (slot + 1) & (capacity - 1);
+                }
+                table[slot] = search->table[i];
+            }
+        }
+        if (search->table) {
+            game_mem_free(gm, search->table);
+        }
+        search->table = table;
+        search->table_capacity = capacity;
+    }
+    
+    uint32_t mask = search->table_capacity - 1;
+    uint32_t slot = (key * 2654435761u) & mask;
+    while (search->table[slot].key && search->table[slot].key != key) {
+        slot = (slot + 1) & mask;
+    }
     
+    game_search_postings_t* postings = &search->table[slot];
+    if (!postings->key) {
+        postings->key = key;
+        search->key_count++;
+    } else if (postings->docs[postings->count - 1] == doc) {
+        return 0;
+    }
+    
+    if (game_grow_array(gm, (void**)&postings->docs, &postings->capacity, postings->count, sizeof(uint32_t)) != 0) {
+        return -1;
+    }
+    postings->docs[postings->count++] = doc;
     return 0;
 }
 
-int game_list_installed(game_manager_t* gm, game_registry_entry_t* games, int max_games) {
-    int count = 0;
-    for (uint32_t i = 0; i < gm->game_count && count < max_games; i++) {
-        if (gm->registry[i].is_installed) {
-            games[count] = gm->registry[i];
-            count++;
+static int game_search_post_text(game_manager_t* gm, const char* text, uint32_t doc) {
+    char folded[MAX_GAME_NAME];
+    const uint8_t* c = (const uint8_t*)folded;
+    uint32_t length = game_search_fold_text(text, folded, sizeof(folded));
+    
+    for (uint32_t i = 0; i < length; i++) {
+        if (game_search_is_word(c[i]) && (i == 0 || !game_search_is_word(c[i - 1]))) {
+            if (game_search_post(gm, GAME_SEARCH_KEY_PREFIX1 | c[i], doc) != 0) {
+                return -1;
+            }
+            if (i + 1 < length && game_search_is_word(c[i + 1]) &&
+                game_search_post(gm, GAME_SEARCH_KEY_PREFIX2 | (c[i] << 8) | c[i + 1], doc) != 0) {
+                return -1;
+            }
+        }
+        if (i + 2 < length &&
+            game_search_post(gm, GAME_SEARCH_KEY_TRIGRAM | (c[i] << 16) | (c[i + 1] << 8) | c[i + 2], doc) != 0) {
+            return -1;
         }
     }
-    return count;
+    return 0;
 }
 
-int game_scan_directory(game_manager_t* gm, const char* directory) {
-    // This would scan the filesystem for .game files
-    // For now, we'll just return success
-    printf("Scanning directory: %s\n", directory);
+// Indexes a newly added registry row under a new document
+int game_search_add(game_manager_t* gm, uint32_t index) {
+    game_search_t* search = &gm->search;
+    game_registry_t* registry = &gm->registry;
+    if (!search->built) {
+        return 0;
+    }
+    gm->registry_sync.dirty |= 1u << GAME_SNAPSHOT_SEARCH;
+    
+    if (game_grow_array(gm, (void**)&search->doc_rows, &search->doc_capacity, search->doc_count,
+                        sizeof(uint32_t)) != 0 ||
+        game_grow_array(gm, (void**)&search->row_docs, &search->row_capacity, index, sizeof(uint32_t)) != 0) {
+        game_search_free(gm);
+        return -1;
+    }
+    
+    uint32_t doc = search->doc_count++;
+    search->doc_rows[doc] = index;
+    search->row_docs[index] = doc;
+    if (game_search_post_text(gm, game_registry_string(registry, registry->names[index]), doc) != 0 ||
+        game_search_post_text(gm, game_registry_string(registry, registry->authors[index]), doc) != 0) {
+        // A partial index would miss games, so drop it and build again later
+        game_search_free(gm);
+        return -1;
+    }
+    return 0;
+}
+
+// Marks a row's document deleted before the registry moves its last row
+// into the row's place
+void game_search_remove(game_manager_t* gm, uint32_t index) {
+    game_search_t* search = &gm->search;
+    uint32_t last = gm->registry.count - 1;
+    if (!search->built || index > last) {
+        return;
+    }
+    gm->registry_sync.dirty |= 1u << GAME_SNAPSHOT_SEARCH;
+    
+    search->doc_rows[search->row_docs[index]] = GAME_SEARCH_DELETED;
+    search->deleted++;
+    if (index != last) {
+        search->row_docs[index] = search->row_docs[last];
+        search->doc_rows[search->row_docs[index]] = index;
+    }
+}
+
+// Indexes every registry row from scratch
+int game_search_build(game_manager_t* gm) {
+    game_search_t* search = &gm->search;
+    game_search_free(gm);
+    search->built = true;
+    
+    for (uint32_t i = 0; i < gm->registry.count; i++) {
+        if (game_search_add(gm, i) != 0) {
+            printf("Failed to build search index\n");
+            return -1;
+        }
+    }
     return 0;
 }
 
+void game_search_free(game_manager_t* gm) {
+    game_search_t* search = &gm->search;
+    gm->registry_sync.dirty |= 1u << GAME_SNAPSHOT_SEARCH;
+    for (uint32_t i = 0; i < search->table_capacity; i++) {
+        if (search->table[i].docs) {
+            game_mem_free(gm, search->table[i].docs);
+        }
+    }
+    if (search->table) game_mem_free(gm, search->table);
+    if (search->doc_rows) game_mem_free(gm, search->doc_rows);
+    if (search->row_docs) game_mem_free(gm, search->row_docs);
+    memset(search, 0, sizeof(game_search_t));
+}
+
+// Finds query at the start of a word in text, or anywhere when that fails.
+// Returns 2 for a word start, 1 for elsewhere and 0 when absent.
+static int game_search_match(const char* text, const char* query) {
+    int found = 0;
+    for (const char* at = strstr(text, query); at; at = strstr(at + 1, query)) {
+        if (at == text || !game_search_is_word((uint8_t)at[-1])) {
+            return 2;
+        }
+        found = 1;
+    }
+    return found;
+}
+
+// Scores a candidate row. Name matches beat author matches, and a row that
+// only shares some trigrams with the query scores by the share it has.
+static uint32_t game_search_score(const game_registry_t* registry, uint32_t index, const char* query,
+                                  uint32_t hits, uint32_t keys) {
+    char folded[MAX_GAME_NAME];
+    game_search_fold_text(game_registry_string(registry, registry->names[index]), folded, sizeof(folded));
+    if (strcmp(folded, query) == 0) {
+        return 1000;
+    }
+    if (strncmp(folded, query, strlen(query)) == 0) {
+        return 900;
+    }
+    
+    int match = game_search_match(folded, query);
+    if (match) {
+        return match == 2 ? 800 : 700;
+    }
+    
+    game_search_fold_text(game_registry_string(registry, registry->authors[index]), folded, sizeof(folded));
+    match = game_search_match(folded, query);
+    if (match) {
+        return match == 2 ? 500 : 400;
+    }
+    return keys ? 100 + 199 * hits / keys : 0;
+}
+
+// Keeps results ordered by score, then by most recently played
+static void game_search_rank(const game_registry_t* registry, game_search_result_t* results, uint32_t* count,
+                             uint32_t max_results, uint32_t index, uint32_t score) {
+    uint32_t position = *count;
+    while (position > 0) {
+        game_search_result_t* other = &results[position - 1];
+        if (other->score > score ||
+            (other->score == score && registry->last_played[other->index] >= registry->last_played[index])) {
+            break;
+        }
+        position--;
+    }
+    if (position >= max_results) {
+        return;
+    }
+    
+    uint32_t end = *count < max_results ? *count : max_results - 1;
+    memmove(results + position + 1, results + position, (end - position) * sizeof(game_search_result_t));
+    results[position].index = index;
+    results[position].score = score;
+    if (*count < max_results) {
+        (*count)++;
+    }
+}
+
+// Ranked type-to-search over names and authors, case-insensitive. Queries
+// of one or two characters match the start of words. Longer queries count
+// how many of their trigrams each game shares, so a game matches with half
+// of them and misspellings still find it. Returns how many of the best
+// max_results rows of the snapshot were stored in results, or -1.
+int game_search_in(const game_registry_snapshot_t* snapshot, const char* query, game_search_result_t* results,
+                   uint32_t max_results) {
+    const game_search_t* search = &snapshot->search;
+    const game_registry_t* registry = &snapshot->registry;
+    if (!search->built) {
+        return -1;
+    }
+    
+    char folded[MAX_GAME_NAME];
+    const uint8_t* c = (const uint8_t*)folded;
+    uint32_t length = game_search_fold_text(query, folded, sizeof(folded));
+    uint32_t count = 0;
+    if (length == 0 || max_results == 0) {
+        return 0;
+    }
+    
+    if (length < 3) {
+        uint32_t key = length == 2 && game_search_is_word(c[1]) ?
+                       GAME_SEARCH_KEY_PREFIX2 | (c[0] << 8) | c[1] : GAME_SEARCH_KEY_PREFIX1 | c[0];
+        const game_search_postings_t* postings = game_search_lookup(search, key);
+        for (uint32_t i = 0; postings && i < postings->count; i++) {
+            uint32_t index = search->doc_rows[postings->docs[i]];
+            if (index != GAME_SEARCH_DELETED) {
+                uint32_t score = game_search_score(registry, index, folded, 0, 0);
+                if (score) {
+                    game_search_rank(registry, results, &count, max_results, index, score);
+                }
+            }
+        }
+        return (int)count;
+    }
+    
+    // Postings of each distinct query trigram
+    uint32_t keys[MAX_GAME_NAME];
+    const game_search_postings_t* lists[MAX_GAME_NAME];
+    uint32_t cursors[MAX_GAME_NAME];
+    uint32_t key_count = 0;
+    uint32_t list_count = 0;
+    for (uint32_t i = 0; i + 2 < length; i++) {
+        uint32_t key = GAME_SEARCH_KEY_TRIGRAM | (c[i] << 16) | (c[i + 1] << 8) | c[i + 2];
+        bool seen = false;
+        for (uint32_t k = 0; k < key_count && !seen; k++) {
+            seen = keys[k] == key;
+        }
+        if (seen) {
+            continue;
+        }
+        keys[key_count++] = key;
+        
+        const game_search_postings_t* postings = game_search_lookup(search, key);
+        if (postings && postings->count > 0) {
+            lists[list_count] = postings;
+            cursors[list_count++] = 0;
+        }
+    }
+    
+    // Postings are in document order, so merging them counts each
+    // document's trigram hits without per-query scratch memory
+    for (;;) {
+        uint32_t doc = GAME_SEARCH_DELETED;
+        for (uint32_t l = 0; l < list_count; l++) {
+            if (cursors[l] < lists[l]->count && lists[l]->docs[cursors[l]] < doc) {
+                doc = lists[l]->docs[cursors[l]];
+            }
+        }
+        if (doc == GAME_SEARCH_DELETED) {
+            break;
+        }
+        
+        uint32_t hits = 0;
+        for (uint32_t l = 0; l < list_count; l++) {
+            if (cursors[l] < lists[l]->count && lists[l]->docs[cursors[l]] == doc) {
+                cursors[l]++;
+                hits++;
+            }
+        }
+        
+        uint32_t index = search->doc_rows[doc];
+        if (index == GAME_SEARCH_DELETED || hits * 2 < key_count) {
+            continue;
+        }
+        uint32_t score = game_search_score(registry, index, folded, hits, key_count);
+        game_search_rank(registry, results, &count, max_results, index, score);
+    }
+    return (int)count;
+}
+
+// Searches the current snapshot. Row indexes in results are that
+// snapshot's and may have moved since; use game_search_in on a held
+// snapshot to keep them meaningful.
+int game_search(game_manager_t* gm, const char* query, game_search_result_t* results, uint32_t max_results) {
+    game_registry_snapshot_t* snapshot = game_registry_acquire(gm);
+    int count = game_search_in(snapshot, query, results, max_results);
+    game_registry_release(gm, snapshot);
+    return count;
+}
+
 uint32_t calculate_checksum(void* data, uint32_t size) {
     uint32_t checksum = 0;
     uint8_t* bytes = (uint8_t*)data;
@@ -603,6 +7268,437 @@ uint32_t calculate_checksum(void* data, uint32_t size) {
     return checksum;
 }
 
+// Hashes one chunk 8 bytes at a time. Chunks are independent, so any
+// number of them can be hashed at once.
+uint32_t game_chunk_checksum(const void* data, uint32_t size, uint32_t index) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint64_t hash = 0x9E3779B97F4A7C15ull ^ ((uint64_t)index << 32) ^ size;
+    
+    while (size >= 8) {
+        uint64_t word;
+        memcpy(&word, bytes, sizeof(word));
+        hash ^= word * 0xFF51AFD7ED558CCDull;
+        hash = ((hash << 31) | (hash >> 33)) * 0x9E3779B97F4A7C15ull;
+        bytes += 8;
+        size -= 8;
+    }
+    
+    uint64_t tail = 0;
+    memcpy(&tail, bytes, size);
+    hash ^= tail * 0xFF51AFD7ED558CCDull;
+    
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ull;
+    hash ^= hash >> 33;
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+static void game_hash_chunk_task(void* arg) {
+    game_hash_task_t* task = (game_hash_task_t*)arg;
+    *task->digest = game_chunk_checksum(task->data, task->size, task->index);
+    game_group_done(task->group);
+}
+
+int game_verifier_init(game_manager_t* gm, game_verifier_t* verifier, uint32_t code_size, uint32_t data_size) {
+    memset(verifier, 0, sizeof(game_verifier_t));
+    verifier->gm = gm;
+    verifier->section_size[0] = code_size;
+    verifier->section_size[1] = data_size;
+    verifier->section_first[0] = 0;
+    verifier->section_first[1] = (code_size + GAME_CHECKSUM_CHUNK_SIZE - 1) / GAME_CHECKSUM_CHUNK_SIZE;
+    verifier->chunk_count = verifier->section_first[1] +
+                            (data_size + GAME_CHECKSUM_CHUNK_SIZE - 1) / GAME_CHECKSUM_CHUNK_SIZE;
+    
+    if (verifier->chunk_count > 0) {
+        verifier->digests = (uint32_t*)game_mem_alloc(gm, verifier->chunk_count * sizeof(uint32_t));
+        verifier->tasks = (game_hash_task_t*)game_mem_alloc(gm, verifier->chunk_count * sizeof(game_hash_task_t));
+        if (!verifier->digests || !verifier->tasks) {
+            if (verifier->digests) game_mem_free(gm, verifier->digests);
+            if (verifier->tasks) game_mem_free(gm, verifier->tasks);
+            return -1;
+        }
+    }
+    
+    game_group_init(&verifier->group);
+    return 0;
+}
+
+// Queues every chunk of a section that lies entirely within the first
+// available bytes, plus the short last chunk once the section is complete
+void game_verifier_advance(game_verifier_t* verifier, uint32_t section, const void* base, uint32_t available) {
+    uint32_t size = verifier->section_size[section];
+    uint32_t submitted = verifier->section_submitted[section];
+    
+    while (submitted < size &&
+           (available - submitted >= GAME_CHECKSUM_CHUNK_SIZE || available == size)) {
+        uint32_t chunk = size - submitted < GAME_CHECKSUM_CHUNK_SIZE ? size - submitted : GAME_CHECKSUM_CHUNK_SIZE;
+        uint32_t index = verifier->section_first[section] + submitted / GAME_CHECKSUM_CHUNK_SIZE;
+        
+        game_hash_task_t* task = &verifier->tasks[index];
+        task->data = (const uint8_t*)base + submitted;
+        task->size = chunk;
+        task->index = index;
+        task->digest = &verifier->digests[index];
+        task->group = &verifier->group;
+        
+        game_group_add(&verifier->group);
+        game_pool_submit(&verifier->gm->pool, game_hash_chunk_task, task);
+        submitted += chunk;
+    }
+    
+    verifier->section_submitted[section] = submitted;
+}
+
+// Waits for outstanding chunks and returns the image checksum, which is
+// only meaningful once both sections have been fully submitted
+uint32_t game_verifier_finish(game_verifier_t* verifier) {
+    game_group_wait(&verifier->group);
+    game_group_destroy(&verifier->group);
+    
+    uint32_t checksum = 0;
+    if (verifier->chunk_count > 0) {
+        checksum = calculate_checksum(verifier->digests, verifier->chunk_count * sizeof(uint32_t));
+        game_mem_free(verifier->gm, verifier->digests);
+        game_mem_free(verifier->gm, verifier->tasks);
+    }
+    return checksum;
+}
+
+uint32_t game_compute_checksum(game_manager_t* gm, const void* code, uint32_t code_size,
+                               const void* data, uint32_t data_size) {
+    game_verifier_t verifier;
+    if (game_verifier_init(gm, &verifier, code_size, data_size) != 0) {
+        return 0;
+    }
+    game_verifier_advance(&verifier, 0, code, code_size);
+    game_verifier_advance(&verifier, 1, data, data_size);
+    return game_verifier_finish(&verifier);
+}
+
+static void* game_pool_worker(void* arg) {
+    game_thread_pool_t* pool = (game_thread_pool_t*)arg;
+    
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (pool->count == 0 && !pool->stopping) {
+            pthread_cond_wait(&pool->not_empty, &pool->lock);
+        }
+        if (pool->count == 0) {
+            break;
+        }
+        
+        game_task_t task = pool->queue[pool->head];
+        pool->head = (pool->head + 1) % GAME_POOL_QUEUE_SIZE;
+        pool->count--;
+        pthread_cond_signal(&pool->not_full);
+        
+        pthread_mutex_unlock(&pool->lock);
+        task.func(task.arg);
+        pthread_mutex_lock(&pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+int game_pool_init(game_thread_pool_t* pool, uint32_t thread_count) {
+    memset(pool, 0, sizeof(game_thread_pool_t));
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->not_empty, NULL);
+    pthread_cond_init(&pool->not_full, NULL);
+    
+    if (thread_count > GAME_POOL_MAX_THREADS) {
+        thread_count = GAME_POOL_MAX_THREADS;
+    }
+    
+    for (uint32_t i = 0; i < thread_count; i++) {
+        if (pthread_create(&pool->threads[i], NULL, game_pool_worker, pool) != 0) {
+            game_pool_shutdown(pool);
+            return -1;
+        }
+        pool->thread_count++;
+    }
+    
+    return 0;
+}
+
+// Queues a task, waiting for space if the queue is full. Without workers
+// the task runs inline.
+void game_pool_submit(game_thread_pool_t* pool, game_task_func func, void* arg) {
+    if (pool->thread_count == 0) {
+        func(arg);
+        return;
+    }
+    
+    pthread_mutex_lock(&pool->lock);
+    while (pool->count == GAME_POOL_QUEUE_SIZE) {
+        pthread_cond_wait(&pool->not_full, &pool->lock);
+    }
+    
+    uint32_t tail = (pool->head + pool->count) % GAME_POOL_QUEUE_SIZE;
+    pool->queue[tail].func = func;
+    pool->queue[tail].arg = arg;
+    pool->count++;
+    pthread_cond_signal(&pool->not_empty);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// Drains queued tasks and joins the workers
+void game_pool_shutdown(game_thread_pool_t* pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->not_empty);
+    pthread_mutex_unlock(&pool->lock);
+    
+    for (uint32_t i = 0; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pool->thread_count = 0;
+    
+    pthread_cond_destroy(&pool->not_full);
+    pthread_cond_destroy(&pool->not_empty);
+    pthread_mutex_destroy(&pool->lock);
+}
+
+void game_group_init(game_task_group_t* group) {
+    group->pending = 0;
+    pthread_mutex_init(&group->lock, NULL);
+    pthread_cond_init(&group->done, NULL);
+}
+
+void game_group_add(game_task_group_t* group) {
+    pthread_mutex_lock(&group->lock);
+    group->pending++;
+    pthread_mutex_unlock(&group->lock);
+}
+
+void game_group_done(game_task_group_t* group) {
+    pthread_mutex_lock(&group->lock);
+    if (--group->pending == 0) {
+        pthread_cond_broadcast(&group->done);
+    }
+    pthread_mutex_unlock(&group->lock);
+}
+
+void game_group_wait(game_task_group_t* group) {
+    pthread_mutex_lock(&group->lock);
+    while (group->pending > 0) {
+        pthread_cond_wait(&group->done, &group->lock);
+    }
+    pthread_mutex_unlock(&group->lock);
+}
+
+void game_group_destroy(game_task_group_t* group) {
+    pthread_cond_destroy(&group->done);
+    pthread_mutex_destroy(&group->lock);
+}
+
+// Built-in LZ codec. A block is a sequence of LZ4-style sequences: a token
+// whose high nibble is the literal count and low nibble the match length
+// minus GAME_LZ_MIN_MATCH (15 means more length bytes follow, each 255 adds
+// on), the literals, then a 16-bit little-endian back-reference offset and
+// any extra match length bytes. The block ends when the output is full.
+
+static inline uint32_t game_lz_read32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint32_t game_lz_hash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - GAME_LZ_HASH_BITS);
+}
+
+static uint8_t* game_lz_write_length(uint8_t* op, uint32_t length) {
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = (uint8_t)length;
+    return op;
+}
+
+uint32_t game_lz_compress_bound(uint32_t size) {
+    return size + size / 255 + 16;
+}
+
+// Returns the compressed size, or 0 if dst is too small
+uint32_t game_lz_compress(const void* src, uint32_t src_size, void* dst, uint32_t dst_capacity) {
+    const uint8_t* ip = (const uint8_t*)src;
+    uint8_t* op = (uint8_t*)dst;
+    uint8_t* op_end = op + dst_capacity;
+    uint32_t table[1 << GAME_LZ_HASH_BITS];
+    uint32_t anchor = 0;
+    uint32_t pos = 0;
+    
+    if (dst_capacity < game_lz_compress_bound(src_size)) {
+        return 0;
+    }
+    
+    memset(table, 0, sizeof(table));
+    
+    // Keep the tail as literals so the match finder never reads past the end
+    uint32_t match_limit = src_size > 12 ? src_size - 12 : 0;
+    
+    while (pos < match_limit) {
+        uint32_t sequence = game_lz_read32(ip + pos);
+        uint32_t slot = game_lz_hash(sequence);
+        uint32_t candidate = table[slot];
+        table[slot] = pos + 1;
+        
+        if (candidate == 0 || pos - (candidate - 1) > 0xFFFF ||
+            game_lz_read32(ip + candidate - 1) != sequence) {
+            pos++;
+            continue;
+        }
+        
+        uint32_t match = candidate - 1;
+        uint32_t length = GAME_LZ_MIN_MATCH;
+        while (pos + length < src_size - 5 && ip[match + length] == ip[pos + length]) {
+            length++;
+        }
+        
+        uint32_t literals = pos - anchor;
+        uint32_t match_code = length - GAME_LZ_MIN_MATCH;
+        uint8_t* token = op++;
+        *token = (uint8_t)(((literals < 15 ? literals : 15) << 4) | (match_code < 15 ? match_code : 15));
+        if (literals >= 15) {
+            op = game_lz_write_length(op, literals - 15);
+        }
+        memcpy(op, ip + anchor, literals);
+        op += literals;
+        
+        uint32_t offset = pos - match;
+        *op++ = (uint8_t)(offset & 0xFF);
+        *op++ = (uint8_t)(offset >> 8);
+        if (match_code >= 15) {
+            op = game_lz_write_length(op, match_code - 15);
+        }
+        
+        pos += length;
+        anchor = pos;
+    }
+    
+    // Final literal-only sequence
+    uint32_t literals = src_size - anchor;
+    if (literals > 0) {
+        *op++ = (uint8_t)((literals < 15 ? literals : 15) << 4);
+        if (literals >= 15) {
+            op = game_lz_write_length(op, literals - 15);
+        }
+        memcpy(op, ip + anchor, literals);
+        op += literals;
+    }
+    
+    return op <= op_end ? (uint32_t)(op - (uint8_t*)dst) : 0;
+}
+
+void game_lz_stream_init(game_lz_stream_t* stream, void* dst, uint32_t dst_size) {
+    memset(stream, 0, sizeof(game_lz_stream_t));
+    stream->out = (uint8_t*)dst;
+    stream->out_size = dst_size;
+    stream->state = GAME_LZ_STATE_TOKEN;
+}
+
+// Decodes as much of the block as the input allows. Sequences may be split
+// at any byte, so input can be fed in whatever chunks the reader produces.
+int game_lz_stream_feed(game_lz_stream_t* stream, const void* input, uint32_t size) {
+    const uint8_t* ip = (const uint8_t*)input;
+    const uint8_t* ip_end = ip + size;
+    
+    while (ip < ip_end) {
+        switch (stream->state) {
+        case GAME_LZ_STATE_TOKEN: {
+            if (stream->out_pos == stream->out_size) {
+                return -1;  // Trailing input after a complete block
+            }
+            uint8_t token = *ip++;
+            stream->literal_length = token >> 4;
+            stream->match_length = (token & 0x0F) + GAME_LZ_MIN_MATCH;
+            stream->state = stream->literal_length == 15 ? GAME_LZ_STATE_LITERAL_LENGTH : GAME_LZ_STATE_LITERALS;
+            break;
+        }
+        case GAME_LZ_STATE_LITERAL_LENGTH: {
+            uint8_t extra = *ip++;
+            stream->literal_length += extra;
+            if (extra != 255) {
+                stream->state = GAME_LZ_STATE_LITERALS;
+            }
+            break;
+        }
+        case GAME_LZ_STATE_LITERALS: {
+            uint32_t available = (uint32_t)(ip_end - ip);
+            uint32_t count = stream->literal_length < available ? stream->literal_length : available;
+            if (count > stream->out_size - stream->out_pos) {
+                return -1;
+            }
+            memcpy(stream->out + stream->out_pos, ip, count);
+            stream->out_pos += count;
+            stream->literal_length -= count;
+            ip += count;
+            if (stream->literal_length == 0) {
+                stream->state = stream->out_pos == stream->out_size ? GAME_LZ_STATE_TOKEN : GAME_LZ_STATE_OFFSET_LOW;
+            }
+            break;
+        }
+        case GAME_LZ_STATE_OFFSET_LOW:
+            stream->offset = *ip++;
+            stream->state = GAME_LZ_STATE_OFFSET_HIGH;
+            break;
+        case GAME_LZ_STATE_OFFSET_HIGH:
+            stream->offset |= (uint32_t)(*ip++) << 8;
+            if (stream->offset == 0 || stream->offset > stream->out_pos) {
+                return -1;
+            }
+            if ((stream->match_length - GAME_LZ_MIN_MATCH) == 15) {
+                stream->state = GAME_LZ_STATE_MATCH_LENGTH;
+            } else if (game_lz_copy_match(stream) != 0) {
+                return -1;
+            }
+            break;
+        case GAME_LZ_STATE_MATCH_LENGTH: {
+            uint8_t extra = *ip++;
+            stream->match_length += extra;
+            if (extra != 255 && game_lz_copy_match(stream) != 0) {
+                return -1;
+            }
+            break;
+        }
+        }
+    }
+    
+    return 0;
+}
+
+int game_lz_copy_match(game_lz_stream_t* stream) {
+    if (stream->match_length > stream->out_size - stream->out_pos) {
+        return -1;
+    }
+    
+    uint8_t* out = stream->out + stream->out_pos;
+    const uint8_t* match = out - stream->offset;
+    if (stream->offset >= stream->match_length) {
+        memcpy(out, match, stream->match_length);
+    } else {
+        // Overlapping copy repeats the last offset bytes
+        for (uint32_t i = 0; i < stream->match_length; i++) {
+            out[i] = match[i];
+        }
+    }
+    
+    stream->out_pos += stream->match_length;
+    stream->state = GAME_LZ_STATE_TOKEN;
+    return 0;
+}
+
+// A block is complete once every output byte has been produced at a
+// sequence boundary
+int game_lz_stream_finish(game_lz_stream_t* stream) {
+    if (stream->out_pos != stream->out_size || stream->state != GAME_LZ_STATE_TOKEN) {
+        return -1;
+    }
+    return 0;
+}
+
 int game_system_shutdown(game_manager_t* gm) {
     // Stop current game if running
     if (gm->current_game) {
@@ -614,6 +7710,17 @@ int game_system_shutdown(game_manager_t* gm) {
         memory_free(gm->mm, gm->framebuffer);
     }
     
+    game_cache_clear(gm);
+    game_module_clear(gm);
+    game_watch_stop(gm);
+    game_registry_free(gm);
+    pthread_mutex_destroy(&gm->scan_cache.lock);
+    game_scan_cache_free(gm);
+    game_saver_stop(gm);
+    game_pool_shutdown(&gm->pool);
+    pthread_mutex_destroy(&gm->io_lock);
+    pthread_mutex_destroy(&gm->registry_sync.writer);
+    
     printf("Game system shutdown complete\n");
     printf("Total games played: %d\n", gm->total_games_played);
     printf("Total play time: %d seconds\n", gm->total_play_time);
@@ -653,20 +7760,28 @@ int main() {
     
     // List available games
     printf("\n=== Available Games ===\n");
-    game_registry_entry_t games[MAX_GAMES];
-    int game_count = game_list_installed(&gm, games, MAX_GAMES);
+    // Games played below change the registry; the snapshot stays as listed
+    game_registry_snapshot_t* snapshot = game_registry_acquire(&gm);
+    const game_registry_t* registry = &snapshot->registry;
+    game_registry_iter_t iter;
+    game_registry_iter_init(&iter, -1, GAME_ENTRY_INSTALLED);
     
-    for (int i = 0; i < game_count; i++) {
-        printf("%d. %s (Type: %d)\n", i + 1, games[i].name, games[i].type);
+    int index;
+    int game_count = 0;
+    while ((index = game_registry_iter_next(snapshot, &iter)) >= 0) {
+        printf("%d. %s (Type: %d)\n", ++game_count, game_registry_string(registry, registry->names[index]),
+               registry->types[index]);
     }
     
     // Demo: Play each game
     printf("\n=== Game Demo Session ===\n");
     
-    for (int i = 0; i < game_count; i++) {
-        printf("\n--- Playing %s ---\n", games[i].name);
+    game_registry_iter_init(&iter, -1, GAME_ENTRY_INSTALLED);
+    while ((index = game_registry_iter_next(snapshot, &iter)) >= 0) {
+        const char* name = game_registry_string(registry, registry->names[index]);
+        printf("\n--- Playing %s ---\n", name);
         
-        if (game_load(&gm, games[i].name) == 0) {
+        if (game_load(&gm, name) == 0) {
             game_run(&gm);
             
             // Save game
@@ -679,6 +7794,7 @@ int main() {
         printf("Press Enter to continue...");
         getchar();
     }
+    game_registry_release(&gm, snapshot);
     
     // Shutdown
     game_system_shutdown(&gm);